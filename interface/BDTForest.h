@@ -0,0 +1,63 @@
+#ifndef PhysicsTools_NanoAOD_BDTForest_h
+#define PhysicsTools_NanoAOD_BDTForest_h
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <iosfwd>
+
+/// Evaluator of the gradient-boosted decision trees of a TMVA BDT weight file (BoostType=Grad, without variable transformations),
+/// giving the same result as TMVA::Reader: 2/(1+exp(-2*sum))-1 for classification, sum + boostWeight of the first tree for regression.
+///
+/// The trees are stored in one flat array of nodes. The two children of a node are stored next to each other, the one taken
+/// when the input is below the cut first, so that a step down the tree is just node = children + (x >= cut). Leaves point to
+/// themselves with a cut that nothing passes, so each tree is walked with a fixed number of steps, without branches.
+class BDTForest {
+    public:
+        BDTForest() : regression_(false), offset_(0) {}
+
+        /// parse a TMVA xml weight file; throws cms::Exception if the file can not be read or uses unsupported features
+        static BDTForest fromTMVAXML(const std::string & fileName) ;
+        /// same, from the content of the file (fileName is only used in the error messages)
+        static BDTForest fromTMVAXMLText(const std::string & text, const std::string & fileName) ;
+
+        /// compact binary form, much faster to read than the xml
+        void writeBinary(std::ostream & out) const ;
+        /// read what writeBinary wrote; returns false if the data is not valid
+        bool readBinary(std::istream & in) ;
+
+        bool isRegression() const { return regression_; }
+        unsigned int nTrees() const { return treeRoot_.size(); }
+        unsigned int nNodes() const { return cut_.size(); }
+        /// input variables, in the order expected by the evaluation
+        const std::vector<std::string> & variables() const { return variables_; }
+
+        /// evaluate one object, with inputs[i] the value of variable i
+        float evaluate(const float * inputs) const {
+            float out;
+            evaluate(inputs, 1, &out);
+            return out;
+        }
+        /// evaluate n objects at once, with the inputs of object j in inputs[j*nVariables ... (j+1)*nVariables-1]
+        void evaluate(const float * inputs, unsigned int n, float * out) const ;
+
+        // for building or serializing the forest (these are otherwise to be considered private)
+        struct Node { int32_t var; float cut; uint32_t children; float response; };
+        void addTree(const std::vector<Node> & nodes, unsigned int depth) ;
+        void setVariables(const std::vector<std::string> & vars) { variables_ = vars; }
+        void setRegression(bool regression, double offset) { regression_ = regression; offset_ = offset; }
+
+    private:
+        std::vector<std::string> variables_;
+        bool regression_;
+        double offset_;
+        // nodes, as structure of arrays; children are absolute indices
+        std::vector<int32_t> var_;
+        std::vector<float> cut_;
+        std::vector<uint32_t> children_;
+        std::vector<float> response_;
+        // first node and depth of each tree
+        std::vector<uint32_t> treeRoot_, treeDepth_;
+};
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef PhysicsTools_NanoAOD_BDTForestRegistry_h
+#define PhysicsTools_NanoAOD_BDTForestRegistry_h
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include "PhysicsTools/NanoAOD/interface/BDTForest.h"
+
+/// Process-wide cache of the BDTForest read from TMVA weight files, keyed by file name, so that each weight file is read,
+/// hashed and parsed once and the immutable forest is shared by all the modules that use it (which are expected to ask
+/// for it once, e.g. in the initializeGlobalCache of a stream module). Concurrent requests for the same file wait for
+/// the first one, requests for different files proceed in parallel.
+///
+/// With useBinaryCache, the forest is also written in its compact binary form next to the weight file (if the directory
+/// is writable), and read from there by later jobs as long as the hash of the weight file matches.
+///
+/// The weight files listed in data/compiledBDT.txt are compiled into C++ by scripts/nanoCompileBDT.py during the build
+/// (which fails if a file does not have the hash given there). The generated code registers each forest under the hash of
+/// its weight file and under its name, size and modification time: get() returns it without reading the file if these
+/// match, and without parsing it if only the hash does.
+class BDTForestRegistry {
+    public:
+        typedef std::shared_ptr<const BDTForest> ForestPtr;
+        typedef BDTForest (*Builder)();
+
+        /// static instances of this register a forest compiled into C++, for the weight files with the given hash, and for
+        /// the file ending with fileName (relative to the src directory) if it has the given size and modification time
+        struct Compiled {
+            Compiled(uint64_t hash, Builder builder, const char * fileName = nullptr, uint64_t size = 0, int64_t mtime = 0) {
+                compiled()[hash] = CompiledForest{builder, fileName ? fileName : "", size, mtime};
+            }
+        };
+
+        /// the forest for a weight file; throws a cms::Exception if it can not be read
+        static ForestPtr get(const std::string & fileName, bool useBinaryCache=false) ;
+
+        /// FNV-1a hash of the content of a file, also stored in the binary cache to check that it is up to date
+        static uint64_t contentHash(const std::string & content) ;
+        /// name of the binary cache of a weight file
+        static std::string binaryCacheName(const std::string & fileName) { return fileName + ".bdtcache"; }
+
+    private:
+        static ForestPtr load(const std::string & fileName, bool useBinaryCache) ;
+
+        struct CompiledForest {
+            Builder builder;
+            std::string fileName;
+            uint64_t size;
+            int64_t mtime;
+        };
+        /// function-local static, as it is filled during the static initialization of other libraries
+        static std::map<uint64_t, CompiledForest> & compiled() { static std::map<uint64_t, CompiledForest> map; return map; }
+
+        struct Entry {
+            std::once_flag loaded;
+            ForestPtr forest;
+        };
+        static std::mutex mutex_; // protects forests_, not the entries
+        static std::map<std::string, std::shared_ptr<Entry>> forests_;
+};
+
+#endif
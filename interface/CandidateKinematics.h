@@ -0,0 +1,69 @@
+#ifndef PhysicsTools_NanoAOD_CandidateKinematics_h
+#define PhysicsTools_NanoAOD_CandidateKinematics_h
+
+#include <cmath>
+#include <vector>
+#include "DataFormats/Provenance/interface/ProductID.h"
+
+/// Kinematics of a collection of candidates, as one array per quantity (same order as the collection).
+/// The product id of the collection is set only by the producers that store the kinematics in the event.
+class CandidateKinematics {
+    public:
+        CandidateKinematics() {}
+
+        /// fill from any collection of candidate-like objects (reco::Candidate, pat objects, trigger objects...)
+        template<typename Coll>
+        void fill(const Coll & coll) {
+            clear(); reserve(coll.size());
+            for (const auto & c : coll) push_back(c.pt(), c.eta(), c.phi(), c.mass(), c.charge());
+        }
+        void push_back(float pt, float eta, float phi, float mass, int charge) {
+            float sinPhi = std::sin(phi), cosPhi = std::cos(phi);
+            pt_.push_back(pt); eta_.push_back(eta); phi_.push_back(phi); mass_.push_back(mass); charge_.push_back(charge);
+            px_.push_back(pt*cosPhi); py_.push_back(pt*sinPhi); pz_.push_back(pt*std::sinh(eta));
+            sinPhi_.push_back(sinPhi); cosPhi_.push_back(cosPhi);
+        }
+        void reserve(unsigned int n) {
+            pt_.reserve(n); eta_.reserve(n); phi_.reserve(n); mass_.reserve(n); charge_.reserve(n);
+            px_.reserve(n); py_.reserve(n); pz_.reserve(n); sinPhi_.reserve(n); cosPhi_.reserve(n);
+        }
+        void clear() {
+            pt_.clear(); eta_.clear(); phi_.clear(); mass_.clear(); charge_.clear();
+            px_.clear(); py_.clear(); pz_.clear(); sinPhi_.clear(); cosPhi_.clear();
+        }
+
+        /// product id of the collection (invalid if not set)
+        const edm::ProductID & id() const { return id_; }
+        void setId(const edm::ProductID & id) { id_ = id; }
+
+        unsigned int size() const { return pt_.size(); }
+        bool empty() const { return pt_.empty(); }
+
+        const std::vector<float> & pt() const { return pt_; }
+        const std::vector<float> & eta() const { return eta_; }
+        const std::vector<float> & phi() const { return phi_; }
+        const std::vector<float> & mass() const { return mass_; }
+        const std::vector<int>   & charge() const { return charge_; }
+        const std::vector<float> & px() const { return px_; }
+        const std::vector<float> & py() const { return py_; }
+        const std::vector<float> & pz() const { return pz_; }
+        const std::vector<float> & sinPhi() const { return sinPhi_; }
+        const std::vector<float> & cosPhi() const { return cosPhi_; }
+
+        /// deltaR^2 between element i and a direction
+        float deltaR2(unsigned int i, float eta, float phi) const {
+            float deta = eta_[i] - eta;
+            float dphi = std::abs(phi_[i] - phi);
+            if (dphi > float(M_PI)) dphi = float(2*M_PI) - dphi;
+            return deta*deta + dphi*dphi;
+        }
+        float deltaR2(unsigned int i, unsigned int j) const { return deltaR2(i, eta_[j], phi_[j]); }
+
+    private:
+        edm::ProductID id_;
+        std::vector<float> pt_, eta_, phi_, mass_;
+        std::vector<int> charge_;
+        std::vector<float> px_, py_, pz_, sinPhi_, cosPhi_;
+};
+
+#endif
@@ -78,6 +78,24 @@ class FlatTable {
             flatTableHelper::MaybeMantissaReduce<T>(mantissaBits).bulk(columnData<T>(columns_.size()-1));
         }
     }
+    /// add a column of default-initialized values, to be filled later through columnData<T>(index); returns the column index.
+    /// once all the columns of a table have been reserved, different columns can be filled concurrently
+    template<typename T>
+    unsigned int reserveColumn(const std::string & name, const std::string & docString, ColumnType type = defaultColumnType<T>()) {
+        if (columnIndex(name) != -1) throw cms::Exception("LogicError", "Duplicated column: "+name);
+        check_type<T>(type); // throws if type is wrong
+        auto & vec = bigVector<T>();
+        columns_.emplace_back(name,docString,type,vec.size());
+        vec.resize(vec.size()+size());
+        return columns_.size()-1;
+    }
+    /// to be called on a reserved column after filling it, to apply the same rounding that addColumn does
+    template<typename T>
+    void reduceColumnPrecision(unsigned int column, int mantissaBits) {
+        if (columns_[column].type == FloatColumn) {
+            flatTableHelper::MaybeMantissaReduce<T>(mantissaBits).bulk(columnData<T>(column));
+        }
+    }
     template<typename T, typename C>
     void addColumnValue(const std::string & name, const C & value, const std::string & docString, ColumnType type = defaultColumnType<T>(),int mantissaBits=-1) {
         if (!singleton()) throw cms::Exception("LogicError", "addColumnValue works only for singleton tables");
@@ -0,0 +1,84 @@
+#ifndef PhysicsTools_NanoAOD_GenHistory_h
+#define PhysicsTools_NanoAOD_GenHistory_h
+
+#include <cstdint>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+#include "DataFormats/Provenance/interface/ProductID.h"
+
+/// Ancestry of the particles of a GenParticle collection (same order as the collection), computed in one pass
+/// over the collection since mothers come before their daughters (mothers with a larger index are ignored, as usual)
+class GenHistory {
+    public:
+        enum Flags {
+            FromHardProcess = 1, // some ancestor is from the hard process
+            FromTau = 2,         // some ancestor is a tau lepton
+            HasVisibleP4 = 4     // status 2 tau, with the visible momentum of its decay below
+        };
+
+        GenHistory() {}
+
+        /// fill from a GenParticle collection with the given product id
+        template<typename Coll>
+        void fill(const Coll & coll, const edm::ProductID & id) {
+            id_ = id;
+            unsigned int n = coll.size();
+            mother_.assign(n, -1); heavyFlavour_.assign(n, 3); flags_.assign(n, 0);
+            visPt_.assign(n, 0); visEta_.assign(n, 0); visPhi_.assign(n, 0); visMass_.assign(n, 0);
+            for (unsigned int i = 0; i < n; ++i) {
+                const auto & p = coll[i];
+                bool has4 = false, has5 = false;
+                for (unsigned int im = 0, nm = p.numberOfMothers(); im < nm; ++im) {
+                    unsigned int mom = p.motherRef(im).key();
+                    if (mom >= i) continue; // prevent circular refs
+                    if (mother_[i] == -1) mother_[i] = mom;
+                    // same as the recursive getParentHadronFlag, but with the flag of the mother already known
+                    int id = std::abs(coll[mom].pdgId());
+                    if (id / 1000 == 5 || id / 100 == 5 || id == 5) has5 = true;
+                    if (id / 1000 == 4 || id / 100 == 4 || id == 4) has4 = true;
+                    if (coll[mom].status() == 2) {
+                        if (heavyFlavour_[mom] == 5) has5 = true;
+                        else if (heavyFlavour_[mom] == 4) has4 = true;
+                    }
+                    if (coll[mom].statusFlags().isHardProcess() || (flags_[mom] & FromHardProcess)) flags_[i] |= FromHardProcess;
+                    if (id == 15 || (flags_[mom] & FromTau)) flags_[i] |= FromTau;
+                }
+                heavyFlavour_[i] = has5 ? 5 : (has4 ? 4 : 3);
+                if (std::abs(p.pdgId()) == 15 && p.status() == 2) {
+                    typename Coll::value_type::LorentzVector vis;
+                    for (const auto & daughter : p.daughterRefVector()) {
+                        int abs_pdgId = std::abs(daughter->pdgId());
+                        if (abs_pdgId == 12 || abs_pdgId == 14 || abs_pdgId == 16) continue; // skip neutrinos
+                        vis += daughter->p4();
+                    }
+                    flags_[i] |= HasVisibleP4;
+                    visPt_[i] = vis.pt(); visEta_[i] = vis.eta(); visPhi_[i] = vis.phi(); visMass_[i] = vis.mass();
+                }
+            }
+        }
+
+        const edm::ProductID & id() const { return id_; }
+        unsigned int size() const { return mother_.size(); }
+
+        /// index of the first mother (-1 if none)
+        int mother(unsigned int i) const { return mother_[i]; }
+        /// 5 if some ancestor (through status 2 particles) is a b hadron or quark, else 4 for c, else 3 (as CandMCMatchTableProducer::getParentHadronFlag)
+        int heavyFlavour(unsigned int i) const { return heavyFlavour_[i]; }
+        bool fromHardProcess(unsigned int i) const { return flags_[i] & FromHardProcess; }
+        bool fromTau(unsigned int i) const { return flags_[i] & FromTau; }
+        bool hasVisibleP4(unsigned int i) const { return flags_[i] & HasVisibleP4; }
+        /// visible momentum of status 2 taus (sum of the non-neutrino daughters), zero for the other particles
+        float visiblePt(unsigned int i) const { return visPt_[i]; }
+        float visibleEta(unsigned int i) const { return visEta_[i]; }
+        float visiblePhi(unsigned int i) const { return visPhi_[i]; }
+        float visibleMass(unsigned int i) const { return visMass_[i]; }
+
+    private:
+        edm::ProductID id_;
+        std::vector<int> mother_;
+        std::vector<uint8_t> heavyFlavour_, flags_;
+        std::vector<float> visPt_, visEta_, visPhi_, visMass_;
+};
+
+#endif
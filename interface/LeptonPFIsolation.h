@@ -0,0 +1,77 @@
+#ifndef PhysicsTools_NanoAOD_LeptonPFIsolation_h
+#define PhysicsTools_NanoAOD_LeptonPFIsolation_h
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "PhysicsTools/NanoAOD/interface/MatchingUtils.h"
+
+/// PF isolation sums of leptons in fixed or pt-dependent (mini-isolation) cones, as computed by PFIsolationProducer
+namespace pfIsolation {
+
+enum Category { Charged = 0, PileUp = 1, Neutral = 2, Photon = 3, NCategories = 4 };
+enum PUCorrection { NoCorrection, DeltaBeta, EffectiveArea };
+
+/// category of a PF candidate, as in pat::getMiniPFIsolation (-1 if it is not used)
+inline int category(int pdgId, int fromPV) {
+    switch (std::abs(pdgId)) {
+        case 211: return fromPV > 1 ? Charged : PileUp;
+        case 130: return Neutral;
+        case 22:  return Photon;
+        default:  return -1;
+    }
+}
+
+struct Isolation {
+    std::string name;
+    bool mini;                    // pt-dependent cone: ktScale/pt, within [dRMin, dRMax]
+    float dR, ktScale, dRMin, dRMax;
+    float veto2[NCategories];     // squared veto cones, -1 if none
+    float ptThreshold;            // for neutrals, photons and pileup
+    bool vetoSourceCandidates;
+    PUCorrection puCorrection;
+    float deltaBetaFactor;
+    float cone(float pt) const { return mini ? std::min(dRMax, std::max(dRMin, ktScale/pt)) : dR; }
+    /// the candidates with deltaR <= veto are not counted (as in pat::getMiniPFIsolation, a veto of 0 removes
+    /// the candidates along the lepton direction), a negative veto keeps them all
+    void setVeto(Category cat, float veto) { veto2[cat] = veto >= 0 ? veto*veto : -1; }
+};
+
+/// PF candidates of the event that can enter the isolations
+struct Candidates {
+    std::vector<float> eta, phi, pt;
+    std::vector<uint8_t> category;
+    std::vector<uint64_t> keys; // matchingKey of each candidate, only if some isolation vetoes the source candidates
+};
+
+/// Adds the pt of the candidates within the cones of the isolations around a lepton to sums[k*NCategories + category] for isolation k.
+/// The grid must be built on the candidates with a deltaR at least as large as the cones, sourceKeys are the matchingKeys of the
+/// source candidates of the lepton (only used by the isolations with vetoSourceCandidates).
+inline void addSums(const std::vector<Isolation> & isolations, const Candidates & cands, const matching::EtaPhiGrid & grid,
+                    float eta, float phi, float pt, const std::vector<uint64_t> & sourceKeys, float * sums) {
+    unsigned int niso = isolations.size();
+    std::vector<float> cone2(niso);
+    float maxCone2 = 0;
+    for (unsigned int k = 0; k < niso; ++k) {
+        float r = isolations[k].cone(pt);
+        cone2[k] = r*r;
+        maxCone2 = std::max(maxCone2, cone2[k]);
+    }
+    grid.forEachWithin(eta, phi, maxCone2, [&](unsigned int j, float dr2) {
+        bool isSource = !sourceKeys.empty() && std::find(sourceKeys.begin(), sourceKeys.end(), cands.keys[j]) != sourceKeys.end();
+        unsigned int cat = cands.category[j];
+        for (unsigned int k = 0; k < niso; ++k) {
+            const Isolation & iso = isolations[k];
+            if (dr2 >= cone2[k] || dr2 <= iso.veto2[cat]) continue;
+            if (cat != Charged && cands.pt[j] <= iso.ptThreshold) continue;
+            if (isSource && iso.vetoSourceCandidates) continue;
+            sums[k*NCategories + cat] += cands.pt[j];
+        }
+    });
+}
+
+} // namespace pfIsolation
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef PhysicsTools_NanoAOD_MVAModels_h
+#define PhysicsTools_NanoAOD_MVAModels_h
+
+#include <map>
+#include <string>
+#include <vector>
+#include "PhysicsTools/NanoAOD/interface/BDTForestRegistry.h"
+
+/// Native evaluation of several BDTs on the same objects, as done by BaseMVAValueMapProducer: the variables of all the models
+/// are evaluated once per object, and each model picks its inputs among them
+namespace mvaModels {
+
+struct Model {
+    std::string name;           // instance label of the ValueMap, empty for the main model
+    std::vector<size_t> inputs; // position in the variables of each input of the model
+    BDTForestRegistry::ForestPtr forest;
+};
+
+/// the positions of the variables of a model, the ones not in positions yet being added after the others
+inline std::vector<size_t> addInputs(std::map<std::string,size_t> & positions, const std::vector<std::string> & variablesOrder) {
+    std::vector<size_t> ret;
+    for (const std::string & v : variablesOrder) ret.push_back(positions.emplace(v, positions.size()).first->second);
+    return ret;
+}
+
+/// Evaluates a model on n objects, with the nv variables of object i in values[i*nv ... (i+1)*nv-1]. The inputs of the model
+/// are copied to buffer, unless they are exactly the nv variables in order (as for the main model when it is alone).
+inline void evaluate(const Model & model, const float * values, unsigned int n, unsigned int nv, std::vector<float> & buffer, float * out) {
+    if (!n) return;
+    const unsigned int ni = model.inputs.size();
+    bool direct = ni == nv;
+    for (unsigned int k = 0; k < ni && direct; ++k) direct = model.inputs[k] == k;
+    if (!direct) {
+        buffer.resize(n*ni);
+        for (unsigned int i = 0; i < n; ++i) {
+            for (unsigned int k = 0; k < ni; ++k) buffer[i*ni+k] = values[i*nv+model.inputs[k]];
+        }
+        values = buffer.data();
+    }
+    model.forest->evaluate(values, n, out);
+}
+
+} // namespace mvaModels
+
+#endif
@@ -1,10 +1,16 @@
 #ifndef NanoAOD_MatchingUtils_h
 #define NanoAOD_MatchingUtils_h
 
-/*#include <utility>
+#include <cstdint>
+#include <cmath>
+#include <limits>
 #include <vector>
-#include "CommonTools/Utils/interface/StringCutObjectSelector.h"
-*/
+#include <algorithm>
+#include <unordered_map>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#include "DataFormats/Provenance/interface/ProductID.h"
 bool matchByCommonSourceCandidatePtr(const auto & c1, const auto & c2) {
     for(unsigned int i1 = 0 ; i1 < c1.numberOfSourceCandidatePtrs();i1++){
         auto  c1s=c1.sourceCandidatePtr(i1);
@@ -21,34 +27,228 @@ bool matchByCommonParentSuperClusterRef(const auto & c1, const auto & c2) {
   return (c1s == c2s);
 }
 
-/*
-template<typename I>
-std::pair<const I &,float> bestMatch(auto item, auto targetColl,const StringCutObjectSelector<I> & cut="1") {
-    float deltaR2Min = 9e99;
-    const I & bm;
-    for(const auto & t : targetColl){
-	if(cut(t)) {
-            float dR2 = deltaR2(item,t);
-            if(dR2 < deltaR2Min){
-                deltaR2Min = dR2;
-                 bm = t;
-   	    }
+/// 64-bit key identifying an element of a collection in the event, from its product id and key
+inline uint64_t matchingKey(const edm::ProductID & id, uint64_t key) {
+    return (uint64_t(id.processIndex()) << 48) ^ (uint64_t(id.productIndex()) << 32) ^ key;
+}
+
+/// keys of the source candidates of an object (same matching as matchByCommonSourceCandidatePtr)
+void sourceCandidateKeys(const auto & c, std::vector<uint64_t> & keys) {
+    keys.clear();
+    for(unsigned int i = 0 ; i < c.numberOfSourceCandidatePtrs();i++){
+        auto ptr = c.sourceCandidatePtr(i);
+        keys.push_back(matchingKey(ptr.id(), ptr.key()));
+    }
+}
+
+/// key of the parent supercluster of an object (same matching as matchByCommonParentSuperClusterRef, so also null refs match each other)
+void parentSuperClusterKeys(const auto & c, std::vector<uint64_t> & keys) {
+    keys.clear();
+    auto ref = c.parentSuperCluster();
+    keys.push_back(ref.isNull() ? std::numeric_limits<uint64_t>::max() : matchingKey(ref.id(), ref.key()));
+}
+
+/// Index of the objects of a collection by keys (e.g. sourceCandidateKeys), to find the objects sharing a key with another one 
+/// with a hash lookup per key instead of comparing all the pairs of objects
+class MatchingKeyIndex {
+    public:
+        /// keysOf(obj, keys) fills the keys of obj
+        template<typename Coll, typename KeysOf>
+        MatchingKeyIndex(const Coll & coll, KeysOf keysOf) {
+            std::vector<uint64_t> keys;
+            for (unsigned int i = 0, n = coll.size(); i < n; ++i) {
+                keysOf(coll[i], keys);
+                for (uint64_t key : keys) index_.emplace(key, i); // does nothing if the key is there already, so the first object is kept
+            }
+        }
+        /// index of the first object of the collection that shares a key with obj, or -1 if none
+        template<typename Obj, typename KeysOf>
+        int firstMatch(const Obj & obj, KeysOf keysOf) const {
+            std::vector<uint64_t> keys;
+            keysOf(obj, keys);
+            int ret = -1;
+            for (uint64_t key : keys) {
+                auto match = index_.find(key);
+                if (match != index_.end() && (ret == -1 || int(match->second) < ret)) ret = match->second;
+            }
+            return ret;
         }
+    private:
+        std::unordered_map<uint64_t,unsigned int> index_;
+};
+
+// ---- deltaR matching on arrays of eta and phi (e.g. from CandidateKinematics) ----
+
+namespace matching {
+
+/// out[i] = deltaR^2 between (eta, phi) and (etas[i], phis[i]), for i < n; phis are assumed to be in [-pi, pi]
+inline void deltaR2(float eta, float phi, const float * etas, const float * phis, unsigned int n, float * out) {
+    unsigned int i = 0;
+#ifdef __AVX2__
+    const __m256 veta = _mm256_set1_ps(eta), vphi = _mm256_set1_ps(phi), twoPi = _mm256_set1_ps(float(2*M_PI));
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    for (; i+8 <= n; i += 8) {
+        __m256 deta = _mm256_sub_ps(_mm256_loadu_ps(etas+i), veta);
+        __m256 dphi = _mm256_andnot_ps(signMask, _mm256_sub_ps(_mm256_loadu_ps(phis+i), vphi)); // |phi_i - phi|
+        dphi = _mm256_min_ps(dphi, _mm256_sub_ps(twoPi, dphi));
+        _mm256_storeu_ps(out+i, _mm256_add_ps(_mm256_mul_ps(deta, deta), _mm256_mul_ps(dphi, dphi)));
+    }
+#endif
+    for (; i < n; ++i) {
+        float deta = etas[i] - eta;
+        float dphi = std::abs(phis[i] - phi);
+        dphi = std::min(dphi, float(2*M_PI) - dphi);
+        out[i] = deta*deta + dphi*dphi;
     }
-    return std::pair<const I &,float>(bm, deltaR2Min);
 }
 
+/// Objects binned in eta and phi, with bins at least as large as the largest deltaR used in the searches,
+/// so that only the 3x3 bins around a direction need to be looked at
+class EtaPhiGrid {
+    public:
+        EtaPhiGrid(const float * etas, const float * phis, unsigned int n, float maxDeltaR) : etas_(etas), phis_(phis) {
+            nPhi_ = std::max(1, int(std::floor(float(2*M_PI)/maxDeltaR)));
+            phiBin_ = float(2*M_PI)/nPhi_;
+            etaMin_ = 0; float etaMax = 0;
+            if (n) { 
+                etaMin_ = *std::min_element(etas, etas+n); 
+                etaMax = *std::max_element(etas, etas+n); 
+            }
+            etaBin_ = maxDeltaR;
+            nEta_ = std::max(1, int(std::floor((etaMax - etaMin_)/etaBin_)) + 1);
+            // counting sort of the objects by cell
+            std::vector<unsigned int> cells(n);
+            cellStart_.assign(nEta_*nPhi_+1, 0);
+            for (unsigned int i = 0; i < n; ++i) { cells[i] = cell(etaIndex(etas[i]), phiIndex(phis[i])); cellStart_[cells[i]+1]++; }
+            for (unsigned int c = 0, nc = nEta_*nPhi_; c < nc; ++c) cellStart_[c+1] += cellStart_[c];
+            items_.resize(n);
+            std::vector<unsigned int> pos(cellStart_.begin(), cellStart_.end()-1);
+            for (unsigned int i = 0; i < n; ++i) items_[pos[cells[i]]++] = i;
+        }
 
-template<typename I>
-std::vector<std::pair<const I &,float>> matchCollections(auto coll, auto targetColl,const StringCutObjectSelector<I> & cut="1") {
-    std::vector<std::pair<I,float>> pairs;
-    if(coll.empty()) return pairs;
-    for(auto & p : coll){
-	pairs.push_back(bestMatch(p,targetColl,cut));
+        /// call f(index, deltaR2) for all the objects within deltaR2 < maxDeltaR2 of (eta, phi), with maxDeltaR2 not larger than the one of the grid
+        template<typename F>
+        void forEachWithin(float eta, float phi, float maxDeltaR2, F f) const {
+            int ieta = etaIndexUnclamped(eta), iphi = phiIndex(phi);
+            std::vector<unsigned int> cand; std::vector<float> dr2;
+            for (int je = std::max(0, ieta-1), jemax = std::min(nEta_-1, ieta+1); je <= jemax; ++je) {
+                for (int dp = -1, dpmax = std::min(1, nPhi_-2); dp <= dpmax; ++dp) { // with less than 3 phi bins, visit each only once
+                    int c = cell(je, (iphi + dp + nPhi_) % nPhi_);
+                    cand.insert(cand.end(), items_.begin()+cellStart_[c], items_.begin()+cellStart_[c+1]);
+                }
+            }
+            if (cand.empty()) return;
+            std::vector<float> etas(cand.size()), phis(cand.size());
+            for (unsigned int i = 0, n = cand.size(); i < n; ++i) { etas[i] = etas_[cand[i]]; phis[i] = phis_[cand[i]]; }
+            dr2.resize(cand.size());
+            deltaR2(eta, phi, etas.data(), phis.data(), cand.size(), dr2.data());
+            for (unsigned int i = 0, n = cand.size(); i < n; ++i) {
+                if (dr2[i] < maxDeltaR2) f(cand[i], dr2[i]);
+            }
+        }
+
+    private:
+        const float * etas_, * phis_;
+        int nEta_, nPhi_;
+        float etaMin_, etaBin_, phiBin_;
+        std::vector<unsigned int> cellStart_, items_;
+
+        int etaIndexUnclamped(float eta) const { return int(std::floor((eta - etaMin_)/etaBin_)); }
+        int etaIndex(float eta) const { return std::min(nEta_-1, std::max(0, etaIndexUnclamped(eta))); }
+        int phiIndex(float phi) const { 
+            int i = int(std::floor((phi + float(M_PI))/phiBin_)); 
+            return ((i % nPhi_) + nPhi_) % nPhi_;
+        }
+        int cell(int ieta, int iphi) const { return ieta*nPhi_ + iphi; }
+};
+
+/// index of the object with the smallest deltaR^2 < maxDeltaR2 from (eta, phi) among those with accept(index) true, and its deltaR^2 (-1 if none)
+template<typename Accept>
+std::pair<int,float> bestMatch(float eta, float phi, const float * etas, const float * phis, unsigned int n, float maxDeltaR2, Accept accept) {
+    std::vector<float> dr2(n);
+    deltaR2(eta, phi, etas, phis, n, dr2.data());
+    std::pair<int,float> best(-1, maxDeltaR2);
+    for (unsigned int i = 0; i < n; ++i) {
+        if (dr2[i] < best.second && accept(i)) best = std::make_pair(int(i), dr2[i]);
+    }
+    return best;
+}
+inline std::pair<int,float> bestMatch(float eta, float phi, const float * etas, const float * phis, unsigned int n, float maxDeltaR2) {
+    return bestMatch(eta, phi, etas, phis, n, maxDeltaR2, [](unsigned int) { return true; });
+}
+/// same using a grid built on the same arrays
+template<typename Accept>
+std::pair<int,float> bestMatch(float eta, float phi, const EtaPhiGrid & grid, float maxDeltaR2, Accept accept) {
+    std::pair<int,float> best(-1, maxDeltaR2);
+    grid.forEachWithin(eta, phi, maxDeltaR2, [&](unsigned int i, float dr2) {
+        if ((dr2 < best.second || (dr2 == best.second && int(i) < best.first)) && accept(i)) best = std::make_pair(int(i), dr2);
+    });
+    return best;
+}
+
+/// index of the object within deltaR^2 < maxDeltaR2 of (eta, phi, pt) with the smallest deltaR^2 + (ptWeight * (pts[i] - pt)/pt)^2, using a grid
+/// built on the objects (-1 if none)
+inline int ptWeightedMatch(float eta, float phi, float pt, const EtaPhiGrid & grid, const float * pts, float maxDeltaR2, float ptWeight) {
+    int ret = -1; float best = std::numeric_limits<float>::max();
+    grid.forEachWithin(eta, phi, maxDeltaR2, [&](unsigned int i, float dr2) {
+        float dpt = pt > 0 ? ptWeight * (pts[i] - pt)/pt : 0;
+        float metric = dr2 + dpt*dpt;
+        if (metric < best || (metric == best && int(i) < ret)) { best = metric; ret = i; }
+    });
+    return ret;
+}
+
+/// indices (in increasing order) of the objects within deltaR^2 < maxDeltaR2 of (eta, phi)
+inline std::vector<unsigned int> withinCone(float eta, float phi, const float * etas, const float * phis, unsigned int n, float maxDeltaR2) {
+    std::vector<float> dr2(n);
+    deltaR2(eta, phi, etas, phis, n, dr2.data());
+    std::vector<unsigned int> ret;
+    for (unsigned int i = 0; i < n; ++i) if (dr2[i] < maxDeltaR2) ret.push_back(i);
+    return ret;
+}
+inline std::vector<unsigned int> withinCone(float eta, float phi, const EtaPhiGrid & grid, float maxDeltaR2) {
+    std::vector<unsigned int> ret;
+    grid.forEachWithin(eta, phi, maxDeltaR2, [&](unsigned int i, float) { ret.push_back(i); });
+    std::sort(ret.begin(), ret.end());
+    return ret;
+}
+
+/// one-to-one assignment from (deltaR^2, (indexA, indexB)) pairs: pairs are used by increasing deltaR,
+/// each object being used at most once. Returns, for each A, the index of its B (or -1)
+inline std::vector<int> assignUnique(std::vector<std::pair<float,std::pair<unsigned int,unsigned int>>> & pairs, unsigned int nA, unsigned int nB) {
+    std::sort(pairs.begin(), pairs.end()); // ties broken by the indices, so the result is reproducible
+    std::vector<int> matchA(nA, -1);
+    std::vector<bool> usedB(nB, false);
+    for (const auto & p : pairs) {
+        unsigned int ia = p.second.first, ib = p.second.second;
+        if (matchA[ia] == -1 && !usedB[ib]) { matchA[ia] = ib; usedB[ib] = true; }
+    }
+    return matchA;
+}
+
+/// one-to-one matching of the objects A to the objects B within maxDeltaR2 (see assignUnique)
+inline std::vector<int> greedyUniqueMatch(const float * etasA, const float * phisA, unsigned int nA, 
+                                          const float * etasB, const float * phisB, unsigned int nB, float maxDeltaR2) {
+    std::vector<std::pair<float,std::pair<unsigned int,unsigned int>>> pairs;
+    std::vector<float> dr2(nB);
+    for (unsigned int ia = 0; ia < nA; ++ia) {
+        deltaR2(etasA[ia], phisA[ia], etasB, phisB, nB, dr2.data());
+        for (unsigned int ib = 0; ib < nB; ++ib) {
+            if (dr2[ib] < maxDeltaR2) pairs.emplace_back(dr2[ib], std::make_pair(ia, ib));
+        }
+    }
+    return assignUnique(pairs, nA, nB);
+}
+/// same using a grid built on the nB objects B
+inline std::vector<int> greedyUniqueMatch(const float * etasA, const float * phisA, unsigned int nA, 
+                                          const EtaPhiGrid & gridB, unsigned int nB, float maxDeltaR2) {
+    std::vector<std::pair<float,std::pair<unsigned int,unsigned int>>> pairs;
+    for (unsigned int ia = 0; ia < nA; ++ia) {
+        gridB.forEachWithin(etasA[ia], phisA[ia], maxDeltaR2, [&](unsigned int ib, float dr2) { pairs.emplace_back(dr2, std::make_pair(ia, ib)); });
     }
-    return pairs;
+    return assignUnique(pairs, nA, nB);
 }
 
-*/
+} // namespace matching
 
 #endif
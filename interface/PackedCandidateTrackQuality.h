@@ -0,0 +1,63 @@
+#ifndef PhysicsTools_NanoAOD_PackedCandidateTrackQuality_h
+#define PhysicsTools_NanoAOD_PackedCandidateTrackQuality_h
+
+#include <cstdint>
+#include <vector>
+#include "DataFormats/Provenance/interface/ProductID.h"
+
+/// Track quality of packed PF candidates of a collection (indexed by their key in the collection), computed once per event so that
+/// the consumers do not build the pseudoTrack of the same candidate again and again. Only some of the candidates are filled
+/// (e.g. the constituents of the jets of the leptons); the others are left to the consumers. The track quantities of a filled
+/// candidate are set only for charged candidates from the PV (fromPV > 1) with track details (hasTrack), and are zero otherwise;
+/// dxy and dz are with respect to the main primary vertex.
+class PackedCandidateTrackQuality {
+    public:
+        enum Flags {
+            Filled = 1,
+            Charged = 2,
+            HasTrack = 4  // charged, from the PV, with track details
+        };
+
+        PackedCandidateTrackQuality() {}
+        PackedCandidateTrackQuality(const edm::ProductID & id, unsigned int size) :
+            id_(id), eta_(size, 0), phi_(size, 0), flags_(size, 0), fromPV_(size, 0),
+            trackPt_(size, 0), nValidHits_(size, 0), nValidPixelHits_(size, 0), normalizedChi2_(size, 0), dxy_(size, 0), dz_(size, 0) {}
+
+        /// fill candidate i, without track quantities
+        void setCandidate(unsigned int i, float eta, float phi, bool charged, int fromPV) {
+            eta_[i] = eta; phi_[i] = phi; flags_[i] = Filled | (charged ? Charged : 0); fromPV_[i] = fromPV;
+        }
+        /// add the track quantities of candidate i, after setCandidate
+        void setTrack(unsigned int i, float trackPt, int nValidHits, int nValidPixelHits, float normalizedChi2, float dxy, float dz) {
+            flags_[i] |= HasTrack;
+            trackPt_[i] = trackPt; nValidHits_[i] = nValidHits; nValidPixelHits_[i] = nValidPixelHits;
+            normalizedChi2_[i] = normalizedChi2; dxy_[i] = dxy; dz_[i] = dz;
+        }
+
+        /// product id of the packed candidate collection
+        const edm::ProductID & id() const { return id_; }
+        unsigned int size() const { return flags_.size(); }
+
+        bool filled(unsigned int i) const { return flags_[i] & Filled; }
+        float eta(unsigned int i) const { return eta_[i]; }
+        float phi(unsigned int i) const { return phi_[i]; }
+        bool charged(unsigned int i) const { return flags_[i] & Charged; }
+        bool hasTrack(unsigned int i) const { return flags_[i] & HasTrack; }
+        int fromPV(unsigned int i) const { return fromPV_[i]; }
+        float trackPt(unsigned int i) const { return trackPt_[i]; }
+        int numberOfValidHits(unsigned int i) const { return nValidHits_[i]; }
+        int numberOfValidPixelHits(unsigned int i) const { return nValidPixelHits_[i]; }
+        float normalizedChi2(unsigned int i) const { return normalizedChi2_[i]; }
+        float dxy(unsigned int i) const { return dxy_[i]; }
+        float dz(unsigned int i) const { return dz_[i]; }
+
+    private:
+        edm::ProductID id_;
+        std::vector<float> eta_, phi_;
+        std::vector<uint8_t> flags_, fromPV_;
+        std::vector<float> trackPt_;
+        std::vector<uint8_t> nValidHits_, nValidPixelHits_;
+        std::vector<float> normalizedChi2_, dxy_, dz_;
+};
+
+#endif
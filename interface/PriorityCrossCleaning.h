@@ -0,0 +1,70 @@
+#ifndef PhysicsTools_NanoAOD_PriorityCrossCleaning_h
+#define PhysicsTools_NanoAOD_PriorityCrossCleaning_h
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "PhysicsTools/NanoAOD/interface/CandidateKinematics.h"
+#include "PhysicsTools/NanoAOD/interface/MatchingUtils.h"
+
+/// Cleaning masks with priorities among the collections, as computed by NanoAODPriorityCrossCleaner
+namespace crossCleaning {
+
+/// what is read from the event for a collection
+struct Objects {
+    CandidateKinematics kin;
+    std::vector<uint8_t> presel;
+    std::vector<std::vector<uint64_t>> keys; // source candidates (see sourceCandidateKeys), filled only if needed
+};
+
+/// an overlap that removes an object
+struct Criterion {
+    unsigned int other; // collection with higher priority
+    float deltaR2;      // <= 0 if not used
+    bool sharedConstituents;
+};
+
+struct Mask {
+    std::string name, doc;
+    std::vector<unsigned int> priority; // collections, highest priority first
+    std::vector<std::vector<Criterion>> criteria; // for each collection, the overlaps that remove it
+};
+
+/// Computes a mask: the collections are processed by decreasing priority, and an object is kept if it passes its preselection
+/// and does not overlap with a kept object of a collection with higher priority. grids[i] must be built on objs[i].kin with
+/// the largest deltaR of the criteria using collection i as other (null if there are none).
+inline void computeMask(const Mask & mask, const std::vector<Objects> & objs, const std::vector<std::unique_ptr<matching::EtaPhiGrid>> & grids,
+                        std::vector<std::vector<uint8_t>> & kept) {
+    kept.resize(objs.size());
+    for (unsigned int i = 0, n = objs.size(); i < n; ++i) kept[i] = objs[i].presel;
+    for (unsigned int i : mask.priority) {
+        for (const Criterion & crit : mask.criteria[i]) {
+            const std::vector<uint8_t> & keptOther = kept[crit.other];
+            std::unordered_set<uint64_t> otherKeys;
+            if (crit.sharedConstituents) {
+                for (unsigned int j = 0, n = keptOther.size(); j < n; ++j) {
+                    if (keptOther[j]) otherKeys.insert(objs[crit.other].keys[j].begin(), objs[crit.other].keys[j].end());
+                }
+            }
+            for (unsigned int j = 0, n = kept[i].size(); j < n; ++j) {
+                if (!kept[i][j]) continue;
+                if (crit.deltaR2 > 0) {
+                    auto match = matching::bestMatch(objs[i].kin.eta()[j], objs[i].kin.phi()[j], *grids[crit.other], crit.deltaR2,
+                                                     [&keptOther](unsigned int k) { return keptOther[k] != 0; });
+                    if (match.first >= 0) { kept[i][j] = 0; continue; }
+                }
+                if (crit.sharedConstituents) {
+                    for (uint64_t key : objs[i].keys[j]) {
+                        if (otherKeys.count(key)) { kept[i][j] = 0; break; }
+                    }
+                }
+            }
+        }
+    }
+}
+
+} // namespace crossCleaning
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef PhysicsTools_NanoAOD_SVGeometry_h
+#define PhysicsTools_NanoAOD_SVGeometry_h
+
+#include <vector>
+#include "DataFormats/Provenance/interface/ProductID.h"
+
+/// Geometry of the secondary vertices of a collection (same order as the collection) with respect to the main primary vertex,
+/// computed once per event for the vertex tables and the jet variables. The flight directions (flightEta, flightPhi) are
+/// stored as plain arrays, so they can be used directly as an eta-phi index with the functions of MatchingUtils.h.
+class SVGeometry {
+    public:
+        SVGeometry() {}
+        explicit SVGeometry(const edm::ProductID & id) : id_(id) {}
+
+        /// the flight vector goes from the primary to the secondary vertex; dist and distError are the 3D distance from VertexDistance3D
+        void push_back(float flightX, float flightY, float flightZ, float flightEta, float flightPhi, double dist, double distError, float pt, float mass, int nTracks) {
+            flightX_.push_back(flightX); flightY_.push_back(flightY); flightZ_.push_back(flightZ);
+            flightEta_.push_back(flightEta); flightPhi_.push_back(flightPhi);
+            dist_.push_back(dist); distError_.push_back(distError); distSig_.push_back(dist/distError); // as Measurement1D::significance
+            pt_.push_back(pt); mass_.push_back(mass); nTracks_.push_back(nTracks);
+        }
+
+        /// product id of the secondary vertex collection
+        const edm::ProductID & id() const { return id_; }
+        unsigned int size() const { return pt_.size(); }
+
+        const std::vector<float> & flightX() const { return flightX_; }
+        const std::vector<float> & flightY() const { return flightY_; }
+        const std::vector<float> & flightZ() const { return flightZ_; }
+        const std::vector<float> & flightEta() const { return flightEta_; }
+        const std::vector<float> & flightPhi() const { return flightPhi_; }
+        const std::vector<double> & dist() const { return dist_; }
+        const std::vector<double> & distError() const { return distError_; }
+        const std::vector<double> & distSig() const { return distSig_; }
+        const std::vector<float> & pt() const { return pt_; }
+        const std::vector<float> & mass() const { return mass_; }
+        const std::vector<int> & nTracks() const { return nTracks_; }
+
+    private:
+        edm::ProductID id_;
+        std::vector<float> flightX_, flightY_, flightZ_, flightEta_, flightPhi_;
+        std::vector<double> dist_, distError_, distSig_;
+        std::vector<float> pt_, mass_;
+        std::vector<int> nTracks_;
+};
+
+#endif
@@ -19,21 +19,37 @@
 #include "DataFormats/PatCandidates/interface/Jet.h"
 
 #include "DataFormats/VertexReco/interface/Vertex.h"
-#include "DataFormats/Candidate/interface/VertexCompositePtrCandidate.h"
+#include "DataFormats/Math/interface/deltaR.h"
 
-#include "RecoVertex/VertexTools/interface/VertexDistance3D.h"
-#include "RecoVertex/VertexPrimitives/interface/ConvertToFromReco.h"
-#include "RecoVertex/VertexPrimitives/interface/VertexState.h"
+#include "PhysicsTools/NanoAOD/interface/SVGeometry.h"
+#include "PhysicsTools/NanoAOD/interface/FlatTable.h"
 
 #include "PhysicsTools/NanoAOD/plugins/BaseMVAValueMapProducer.h"
+#include "PhysicsTools/NanoAOD/interface/MatchingUtils.h"
 #include <vector>
 
+/// The lepton of each jet is the first muon, or if none the first electron, linked to it by PATObjectCrossLinker,
+/// read from its link table for the jets (jetLinks, with the columns muonIdx1 and electronIdx1) and from the same
+/// muons and electrons given to the linker.
 class BJetEnergyRegressionMVA : public BaseMVAValueMapProducer<pat::Jet> {
 	public:
-	  explicit BJetEnergyRegressionMVA(const edm::ParameterSet &iConfig):
-		BaseMVAValueMapProducer<pat::Jet>(iConfig),
-    		pvsrc_(edm::stream::EDProducer<>::consumes<std::vector<reco::Vertex>>(iConfig.getParameter<edm::InputTag>("pvsrc"))),
-    		svsrc_(edm::stream::EDProducer<>::consumes<edm::View<reco::VertexCompositePtrCandidate>> (iConfig.getParameter<edm::InputTag>("svsrc")))
+	  explicit BJetEnergyRegressionMVA(const edm::ParameterSet &iConfig, const BaseMVACache * cache):
+		BaseMVAValueMapProducer<pat::Jet>(iConfig, cache),
+    		pvsrc_(edm::stream::EDProducer<edm::GlobalCache<BaseMVACache>>::consumes<std::vector<reco::Vertex>>(iConfig.getParameter<edm::InputTag>("pvsrc"))),
+    		svgeomsrc_(edm::stream::EDProducer<edm::GlobalCache<BaseMVACache>>::consumes<SVGeometry> (iConfig.getParameter<edm::InputTag>("svGeometry"))),
+    		jetLinks_(edm::stream::EDProducer<edm::GlobalCache<BaseMVACache>>::consumes<FlatTable>(iConfig.getParameter<edm::InputTag>("jetLinks"))),
+    		muons_(edm::stream::EDProducer<edm::GlobalCache<BaseMVACache>>::consumes<edm::View<pat::Muon>>(iConfig.getParameter<edm::InputTag>("muons"))),
+    		electrons_(edm::stream::EDProducer<edm::GlobalCache<BaseMVACache>>::consumes<edm::View<pat::Electron>>(iConfig.getParameter<edm::InputTag>("electrons"))),
+		iNPVs_(this->variableIndex("nPVs")),
+		iLeptonPtRel_(this->variableIndex("Jet_leptonPtRel")),
+		iLeptonPt_(this->variableIndex("Jet_leptonPt")),
+		iLeptonDeltaR_(this->variableIndex("Jet_leptonDeltaR")),
+		iLeadTrackPt_(this->variableIndex("Jet_leadTrackPt")),
+		iVtxPt_(this->variableIndex("Jet_vtxPt")),
+		iVtxMass_(this->variableIndex("Jet_vtxMass")),
+		iVtx3dL_(this->variableIndex("Jet_vtx3dL")),
+		iVtx3deL_(this->variableIndex("Jet_vtx3deL")),
+		iVtxNtrk_(this->variableIndex("Jet_vtxNtrk"))
 
 	  {
 
@@ -41,50 +57,56 @@ class BJetEnergyRegressionMVA : public BaseMVAValueMapProducer<pat::Jet> {
 	  }
 	  void readAdditionalCollections(edm::Event&iEvent, const edm::EventSetup&) override {
 		iEvent.getByToken(pvsrc_, pvs_);
-		iEvent.getByToken(svsrc_, svs_);
+		// flight directions and distances of the SVs, computed once per event
+		iEvent.getByToken(svgeomsrc_, svgeom_);
+		iEvent.getByToken(muons_, muons_h_);
+		iEvent.getByToken(electrons_, electrons_h_);
+		edm::Handle<FlatTable> links;
+		iEvent.getByToken(jetLinks_, links);
+		int muCol = links->columnIndex("muonIdx1"), eleCol = links->columnIndex("electronIdx1");
+		if (muCol == -1 || eleCol == -1) throw cms::Exception("Configuration", "The link table "+links->name()+" must have the columns muonIdx1 and electronIdx1\n");
+		auto muIdx = links->columnData<int>(muCol), eleIdx = links->columnData<int>(eleCol);
+		muonIdx_.assign(muIdx.begin(), muIdx.end());
+		electronIdx_.assign(eleIdx.begin(), eleIdx.end());
 	  }
 
-          void fillAdditionalVariables(const pat::Jet&j)  override {
-		this->setValue("nPVs",pvs_->size());
-		BaseMVAValueMapProducer<pat::Jet>::setValue("Jet_leptonPtRel",0);
-
-		if(!j.overlaps("muons").empty()) { 
-			const auto *lep=dynamic_cast<const pat::Muon *>(&*j.overlaps("muons")[0]);
-			if(lep!=nullptr) {BaseMVAValueMapProducer<pat::Jet>::setValue("Jet_leptonPtRel",lep->userFloat("ptRel"));}
-		}
-		else if(!j.overlaps("electrons").empty()) {
-			const auto *lep=dynamic_cast<const pat::Electron *>(&*j.overlaps("electrons")[0]);
-			if(lep!=nullptr) {BaseMVAValueMapProducer<pat::Jet>::setValue("Jet_leptonPtRel",lep->userFloat("ptRel"));}
-		}
+          void fillAdditionalVariables(const pat::Jet&j, unsigned int index)  override {
+		this->setValue(iNPVs_,pvs_->size());
+		this->setValue(iLeptonPtRel_,0);
+		this->setValue(iLeptonPt_,0);
+		this->setValue(iLeptonDeltaR_,0);
+
+		if (index >= muonIdx_.size()) throw cms::Exception("LogicError", "The jet link table does not have the size of src\n");
+		auto setLepton = [&](const auto & lep) {
+			this->setValue(iLeptonPtRel_,lep.userFloat("ptRel"));
+			this->setValue(iLeptonPt_,lep.pt());
+			this->setValue(iLeptonDeltaR_,reco::deltaR(j,lep));
+		};
+		if(muonIdx_[index] >= 0) setLepton((*muons_h_)[muonIdx_[index]]);
+		else if(electronIdx_[index] >= 0) setLepton((*electrons_h_)[electronIdx_[index]]);
 		
 		float ptMax=0;
 		for(const auto & d : j.daughterPtrVector()){if(d->pt()>ptMax) ptMax=d->pt();}
-		BaseMVAValueMapProducer<pat::Jet>::setValue("Jet_leadTrackPt",ptMax);
+		this->setValue(iLeadTrackPt_,ptMax);
 
 		//Fill vertex properties
-		VertexDistance3D vdist;
 		float maxFoundSignificance=0;
-		const auto & pv = (*pvs_)[0];
-	  	this->setValue("Jet_vtxPt",0);
-	   	this->setValue("Jet_vtxMass",0);
-    		this->setValue("Jet_vtx3dL",0);
-    		this->setValue("Jet_vtx3deL",0);
-    		this->setValue("Jet_vtxNtrk",0);
-
-		for(const auto &sv: *svs_){
-	      	GlobalVector flightDir(sv.vertex().x() - pv.x(), sv.vertex().y() - pv.y(),sv.vertex().z() - pv.z());
-	            GlobalVector jetDir(j.px(),j.py(),j.pz());
-                    if( Geom::deltaR2( flightDir, jetDir ) < 0.09 ){
-		        Measurement1D dl= vdist.distance(pv,VertexState(RecoVertex::convertPos(sv.position()),RecoVertex::convertError(sv.error())));
-			if(dl.significance() > maxFoundSignificance){
-				 maxFoundSignificance=dl.significance();
-				 this->setValue("Jet_vtxPt",sv.pt());
-				 this->setValue("Jet_vtxMass",sv.p4().M());
-				 this->setValue("Jet_vtx3dL",dl.value());
-				 this->setValue("Jet_vtx3deL",dl.error());
-				 this->setValue("Jet_vtxNtrk",sv.numberOfSourceCandidatePtrs());
+	  	this->setValue(iVtxPt_,0);
+	   	this->setValue(iVtxMass_,0);
+    		this->setValue(iVtx3dL_,0);
+    		this->setValue(iVtx3deL_,0);
+    		this->setValue(iVtxNtrk_,0);
+
+		const SVGeometry & svs = *svgeom_;
+		for(unsigned int isv : matching::withinCone(j.eta(), j.phi(), svs.flightEta().data(), svs.flightPhi().data(), svs.size(), 0.09)){
+			if(svs.distSig()[isv] > maxFoundSignificance){
+				 maxFoundSignificance=svs.distSig()[isv];
+				 this->setValue(iVtxPt_,svs.pt()[isv]);
+				 this->setValue(iVtxMass_,svs.mass()[isv]);
+				 this->setValue(iVtx3dL_,svs.dist()[isv]);
+				 this->setValue(iVtx3deL_,svs.distError()[isv]);
+				 this->setValue(iVtxNtrk_,svs.nTracks()[isv]);
 			}	
-		    } 
 		}
 
 	  }
@@ -92,15 +114,27 @@ class BJetEnergyRegressionMVA : public BaseMVAValueMapProducer<pat::Jet> {
           static void fillDescriptions(edm::ConfigurationDescriptions& descriptions) {
             edm::ParameterSetDescription desc = BaseMVAValueMapProducer<pat::Jet>::getDescription();
             desc.add<edm::InputTag>("pvsrc")->setComment("primary vertices input collection");
-            desc.add<edm::InputTag>("svsrc")->setComment("secondary vertices input collection");
+            desc.add<edm::InputTag>("svGeometry")->setComment("SVGeometry of the secondary vertices, with respect to the first vertex of pvsrc");
+            desc.add<edm::InputTag>("jetLinks")->setComment("link table of PATObjectCrossLinker for the jets of src");
+            desc.add<edm::InputTag>("muons")->setComment("muons given to PATObjectCrossLinker");
+            desc.add<edm::InputTag>("electrons")->setComment("electrons given to PATObjectCrossLinker");
             descriptions.add("BJetEnergyRegressionMVA",desc);
           }
 
         private:
 	  const edm::EDGetTokenT<std::vector<reco::Vertex>> pvsrc_;
  	  edm::Handle<std::vector<reco::Vertex>> pvs_;
-          const edm::EDGetTokenT<edm::View<reco::VertexCompositePtrCandidate> > svsrc_;
- 	  edm::Handle<edm::View<reco::VertexCompositePtrCandidate>> svs_;
+          const edm::EDGetTokenT<SVGeometry> svgeomsrc_;
+ 	  edm::Handle<SVGeometry> svgeom_;
+	  const edm::EDGetTokenT<FlatTable> jetLinks_;
+	  const edm::EDGetTokenT<edm::View<pat::Muon>> muons_;
+ 	  edm::Handle<edm::View<pat::Muon>> muons_h_;
+	  const edm::EDGetTokenT<edm::View<pat::Electron>> electrons_;
+ 	  edm::Handle<edm::View<pat::Electron>> electrons_h_;
+	  // index of the first linked muon and electron of each jet (-1 if none)
+	  std::vector<int> muonIdx_, electronIdx_;
+	  // positions of the variables filled here
+	  const size_t iNPVs_, iLeptonPtRel_, iLeptonPt_, iLeptonDeltaR_, iLeadTrackPt_, iVtxPt_, iVtxMass_, iVtx3dL_, iVtx3deL_, iVtxNtrk_;
 	  
 };
 
@@ -39,34 +39,65 @@
 
 #include "CommonTools/Utils/interface/StringObjectFunction.h"
 #include "DataFormats/Common/interface/ValueMap.h"
+#include "PhysicsTools/NanoAOD/interface/BDTForestRegistry.h"
+#include "PhysicsTools/NanoAOD/interface/MVAModels.h"
 #include <string>
+/// shared by the streams of a module: the forests of the native backend, for the main model and then for each of the additional
+/// models (empty with the TMVA backend, which needs one reader per stream)
+struct BaseMVACache {
+  std::vector<BDTForestRegistry::ForestPtr> forests;
+};
+
 //
 // class declaration
 //
 
 template <typename T>
-class BaseMVAValueMapProducer : public edm::stream::EDProducer<> {
+class BaseMVAValueMapProducer : public edm::stream::EDProducer<edm::GlobalCache<BaseMVACache>> {
    public:
-  explicit BaseMVAValueMapProducer(const edm::ParameterSet &iConfig):
+  explicit BaseMVAValueMapProducer(const edm::ParameterSet &iConfig, const BaseMVACache * cache):
     src_(consumes<edm::View<T>>(iConfig.getParameter<edm::InputTag>("src"))),
     variablesOrder_(iConfig.getParameter<std::vector<std::string>>("variablesOrder")),
     name_(iConfig.getParameter<std::string>("name")),
-    isClassifier_(iConfig.getParameter<bool>("isClassifier"))  
+    isClassifier_(iConfig.getParameter<bool>("isClassifier"))
   {
       edm::ParameterSet const & varsPSet = iConfig.getParameter<edm::ParameterSet>("variables");
+      std::map<std::string,int> firstWithExpr;
       for (const std::string & vname : varsPSet.getParameterNamesForType<std::string>()) {
-	  funcs_.emplace_back(std::pair<std::string,StringObjectFunction<T,true>>(vname,varsPSet.getParameter<std::string>(vname)));
+	  const std::string & expr = varsPSet.getParameter<std::string>(vname);
+	  auto first = firstWithExpr.emplace(expr, funcs_.size());
+	  sameAs_.push_back(first.second ? -1 : first.first->second);
+	  funcs_.emplace_back(std::pair<std::string,StringObjectFunction<T,true>>(vname,expr));
+      }
+
+      // the variables of the additional models that are not inputs of the main one go after its inputs
+      std::vector<size_t> mainInputs = mvaModels::addInputs(positions_, variablesOrder_);
+      std::vector<edm::ParameterSet> models;
+      if (iConfig.existsAs<std::vector<edm::ParameterSet>>("models")) models = iConfig.getParameter<std::vector<edm::ParameterSet>>("models");
+      if (!cache->forests.empty()) {
+	models_.emplace_back(); // the main model
+	models_.back().forest = cache->forests.front();
+	models_.back().inputs = mainInputs;
+      } else if (!models.empty()) {
+	throw cms::Exception("Configuration", "Additional models are only supported with the native backend\n");
+      }
+      for(unsigned int im = 0; im < models.size(); ++im){
+	models_.emplace_back();
+	mvaModels::Model & model = models_.back();
+	model.name = models[im].getParameter<std::string>("name");
+	if (model.name.empty()) throw cms::Exception("Configuration", "Additional models need a name\n");
+	model.forest = cache->forests[im+1];
+	model.inputs = mvaModels::addInputs(positions_, models[im].getParameter<std::vector<std::string>>("variablesOrder"));
       }
+      values_.resize(positions_.size());
+      for(const auto & p : funcs_) funcPositions_.push_back(variableIndex(p.first));
 
-      values_.resize(variablesOrder_.size());
-      size_t i=0;
-      for(const auto & v : variablesOrder_){
-	positions_[v]=i;
-	reader_.AddVariable(v,(&values_.front())+i);
-	i++;
+      if (models_.empty()) {
+	for(size_t i = 0; i < variablesOrder_.size(); ++i) reader_.AddVariable(variablesOrder_[i],(&values_.front())+mainInputs[i]);
+	reader_.BookMVA(name_,iConfig.getParameter<edm::FileInPath>("weightFile").fullPath());
       }
-      reader_.BookMVA(name_,iConfig.getParameter<edm::FileInPath>("weightFile").fullPath() );
-      produces<edm::ValueMap<float>>();
+      for(const mvaModels::Model & model : models_) produces<edm::ValueMap<float>>(model.name);
+      if (models_.empty()) produces<edm::ValueMap<float>>();
 
   }
   ~BaseMVAValueMapProducer() override {}
@@ -74,31 +105,76 @@ class BaseMVAValueMapProducer : public edm::stream::EDProducer<> {
   void setValue(const std::string var,float val) {
 	values_[positions_[var]]=val;
   }
+  /// faster version, with the index from variableIndex
+  void setValue(size_t index,float val) {
+	values_[index]=val;
+  }
+  size_t variableIndex(const std::string & var) const {
+	auto match = positions_.find(var);
+	if (match == positions_.end()) throw cms::Exception("Configuration", "Unknown MVA variable "+var+"\n");
+	return match->second;
+  }
   
+  static std::unique_ptr<BaseMVACache> initializeGlobalCache(const edm::ParameterSet &);
+  static void globalEndJob(const BaseMVACache *) {}
+
   static edm::ParameterSetDescription getDescription();
   static void fillDescriptions(edm::ConfigurationDescriptions& descriptions);
 
    private:
-  void beginStream(edm::StreamID) override {};
   void produce(edm::Event&, const edm::EventSetup&) override;
   void endStream() override {};
+  void putValueMap(edm::Event & iEvent, const edm::Handle<edm::View<T>> & src, const std::vector<float> & values, const std::string & label) const ;
 
   ///to be implemented in derived classes, filling values for additional variables
   virtual void readAdditionalCollections(edm::Event&, const edm::EventSetup&)  {}
-  virtual void fillAdditionalVariables(const T&)  {}
+  /// index is the position of the object in src
+  virtual void fillAdditionalVariables(const T&, unsigned int index)  {}
 
 
   edm::EDGetTokenT<edm::View<T>> src_;
   std::map<std::string,size_t> positions_;
   std::vector<std::pair<std::string,StringObjectFunction<T,true>>> funcs_;
+  std::vector<size_t> funcPositions_; // position of each of funcs_ in values_
+  std::vector<int> sameAs_; // for each of funcs_, the index of an earlier one with the same expression (-1 if none), evaluated only once
   std::vector<std::string> variablesOrder_;
   std::vector<float> values_;
   TMVA::Reader reader_;
+  /// native evaluation of the BDTs, used instead of reader_ unless backend is "TMVA": the main model (with an empty name), then the
+  /// additional ones, each putting a ValueMap with its name as instance label. All the variables are evaluated once for all of them.
+  std::vector<mvaModels::Model> models_;
   std::string name_;
   bool isClassifier_;
 
 };
 
+template <typename T>
+std::unique_ptr<BaseMVACache>
+BaseMVAValueMapProducer<T>::initializeGlobalCache(const edm::ParameterSet & iConfig)
+{
+  auto cache = std::make_unique<BaseMVACache>();
+  const std::string & backend = iConfig.existsAs<std::string>("backend") ? iConfig.getParameter<std::string>("backend") : "native";
+  if (backend == "TMVA") return cache;
+  if (backend != "native") throw cms::Exception("Configuration", "Unknown backend '"+backend+"'\n");
+  // parsed once, and shared with the other modules using the same weight file
+  std::vector<edm::ParameterSet> models(1, iConfig);
+  if (iConfig.existsAs<std::vector<edm::ParameterSet>>("models")) {
+    for (const auto & pset : iConfig.getParameter<std::vector<edm::ParameterSet>>("models")) models.push_back(pset);
+  }
+  for (const auto & pset : models) {
+    const std::string & weightFile = pset.getParameter<edm::FileInPath>("weightFile").fullPath();
+    bool binaryCache = pset.existsAs<bool>("binaryCache") ? pset.getParameter<bool>("binaryCache") : false;
+    cache->forests.push_back(BDTForestRegistry::get(weightFile, binaryCache));
+    if (cache->forests.back()->variables() != pset.getParameter<std::vector<std::string>>("variablesOrder")) {
+      throw cms::Exception("Configuration", "variablesOrder does not match the variables of "+weightFile+"\n");
+    }
+    if (cache->forests.back()->isRegression() == pset.getParameter<bool>("isClassifier")) {
+      throw cms::Exception("Configuration", "isClassifier does not match the analysis type of "+weightFile+"\n");
+    }
+  }
+  return cache;
+}
+
 template <typename T>
 void
 BaseMVAValueMapProducer<T>::produce(edm::Event& iEvent, const edm::EventSetup& iSetup)
@@ -106,22 +182,44 @@ BaseMVAValueMapProducer<T>::produce(edm::Event& iEvent, const edm::EventSetup& i
   edm::Handle<edm::View<T>> src;
   iEvent.getByToken(src_, src);
   readAdditionalCollections(iEvent,iSetup);
-  
+
   std::vector<float> mvaOut;
   mvaOut.reserve(src->size());
-  for(auto const & o: *src) {
-	for(auto const & p : funcs_ ){
-		values_[positions_[p.first]]=p.second(o);
+  std::vector<float> inputs; // with the native evaluation, the inputs of all the objects are collected and evaluated together
+  if (!models_.empty()) inputs.reserve(src->size()*values_.size());
+  for(unsigned int i = 0, n = src->size(); i < n; ++i) {
+	const T & o = (*src)[i];
+	for(unsigned int iv = 0, nv = funcs_.size(); iv < nv; ++iv){
+		const auto & p = funcs_[iv];
+		if (sameAs_[iv] >= 0) values_[funcPositions_[iv]]=values_[funcPositions_[sameAs_[iv]]];
+		else values_[funcPositions_[iv]]=p.second(o);
 	}
-        fillAdditionalVariables(o);
-	mvaOut.push_back(isClassifier_ ? reader_.EvaluateMVA(name_) : reader_.EvaluateRegression(name_)[0]);
+        fillAdditionalVariables(o, i);
+	if (!models_.empty()) inputs.insert(inputs.end(), values_.begin(), values_.end());
+	else mvaOut.push_back(isClassifier_ ? reader_.EvaluateMVA(name_) : reader_.EvaluateRegression(name_)[0]);
+  }
+  if (models_.empty()) {
+	putValueMap(iEvent, src, mvaOut, "");
+	return;
+  }
+  unsigned int n = src->size(), nv = values_.size();
+  mvaOut.resize(n);
+  std::vector<float> modelInputs;
+  for (const mvaModels::Model & model : models_) {
+	mvaModels::evaluate(model, inputs.data(), n, nv, modelInputs, mvaOut.data());
+	putValueMap(iEvent, src, mvaOut, model.name);
   }
+}
+
+template <typename T>
+void
+BaseMVAValueMapProducer<T>::putValueMap(edm::Event & iEvent, const edm::Handle<edm::View<T>> & src, const std::vector<float> & values, const std::string & label) const
+{
   std::unique_ptr<edm::ValueMap<float>> mvaV(new edm::ValueMap<float>());
   edm::ValueMap<float>::Filler filler(*mvaV);
-  filler.insert(src,mvaOut.begin(),mvaOut.end());
+  filler.insert(src,values.begin(),values.end());
   filler.fill();
-  iEvent.put(std::move(mvaV));
-
+  iEvent.put(std::move(mvaV), label);
 }
 
 template <typename T>
@@ -136,6 +234,15 @@ BaseMVAValueMapProducer<T>::getDescription(){
   variables.setAllowAnything();
   desc.add<edm::ParameterSetDescription>("variables", variables)->setComment("list of input variable definitions");
   desc.add<edm::FileInPath>("weightFile")->setComment("xml weight file");
+  desc.addOptional<std::string>("backend")->setComment("native (default): built-in evaluation of TMVA BDTG weight files, TMVA: TMVA::Reader");
+  desc.addOptional<bool>("binaryCache")->setComment("native backend: keep a binary copy of the parsed weight file next to it, for faster startup (default false)");
+  edm::ParameterSetDescription model;
+  model.add<std::string>("name")->setComment("name of the model, used as instance label of its ValueMap");
+  model.add<edm::FileInPath>("weightFile")->setComment("TMVA BDTG xml weight file");
+  model.add<bool>("isClassifier")->setComment("is a classifier discriminator");
+  model.add<std::vector<std::string>>("variablesOrder")->setComment("ordered list of the input variable names of the model");
+  model.addOptional<bool>("binaryCache")->setComment("as for the main model");
+  desc.addVPSetOptional("models", model)->setComment("native backend: additional models evaluated on the same objects, sharing the evaluation of the variables with the main one");
   return desc;
 }
 
@@ -7,6 +7,7 @@
 #include "DataFormats/Common/interface/View.h"
 #include "DataFormats/Candidate/interface/Candidate.h"
 #include "DataFormats/HepMCCandidate/interface/GenParticle.h"
+#include "PhysicsTools/NanoAOD/interface/GenHistory.h"
 
 #include <vector>
 #include <iostream>
@@ -43,6 +44,9 @@ class CandMCMatchTableProducer : public edm::global::EDProducer<> {
 	    if ( type_ == MTau ) {
 	      candMapVisTau_ = consumes<edm::Association<reco::GenParticleCollection>>(params.getParameter<edm::InputTag>("mcMapVisTau"));
 	    }
+            if (params.existsAs<edm::InputTag>("genHistory")) {
+                genHistory_ = consumes<GenHistory>(params.getParameter<edm::InputTag>("genHistory"));
+            }
         }
 
         ~CandMCMatchTableProducer() override {}
@@ -63,13 +67,25 @@ class CandMCMatchTableProducer : public edm::global::EDProducer<> {
 	      iEvent.getByToken(candMapVisTau_, mapVisTau);
 	    }
 
+            // precomputed ancestry of the gen particles, if available and made from the matched collection
+            edm::Handle<GenHistory> history;
+            if (!genHistory_.isUninitialized()) iEvent.getByToken(genHistory_, history);
+            auto parentHadronFlag = [&history](const reco::GenParticleRef & match) {
+                return (history.isValid() && history->id() == match.id()) ? history->heavyFlavour(match.key()) : getParentHadronFlag(match);
+            };
+
+            // a matcher run on the same selection (e.g. a RefVector) fills the map by position in it, otherwise by the products pointed to
+            auto lookup = [&cands](const edm::Association<reco::GenParticleCollection> & m, unsigned int i) {
+                return m.contains(cands.id()) ? m.get(cands.id(), i) : m[cands->ptrAt(i)];
+            };
+
             std::vector<int> key(ncand, -1), flav(ncand, 0);
             for (unsigned int i = 0; i < ncand; ++i) {
 	      //std::cout << "cand #" << i << ": pT = " << cands->ptrAt(i)->pt() << ", eta = " << cands->ptrAt(i)->eta() << ", phi = " << cands->ptrAt(i)->phi() << std::endl;
-                reco::GenParticleRef match = (*map)[cands->ptrAt(i)];
+                reco::GenParticleRef match = lookup(*map, i);
 		reco::GenParticleRef matchVisTau;
 		if ( type_ == MTau ) {
-		  matchVisTau = (*mapVisTau)[cands->ptrAt(i)];
+		  matchVisTau = lookup(*mapVisTau, i);
 		}
                 if      ( match.isNonnull()       ) key[i] = match.key();
 		else if ( matchVisTau.isNonnull() ) key[i] = matchVisTau.key();
@@ -78,12 +94,12 @@ class CandMCMatchTableProducer : public edm::global::EDProducer<> {
                     case MMuon:		        
                         if (match->isPromptFinalState()) flav[i] = 1; // prompt
                         else if (match->isDirectPromptTauDecayProductFinalState()) flav[i] = 15; // tau
-                        else flav[i] = getParentHadronFlag(match); // 3 = light, 4 = charm, 5 = b
+                        else flav[i] = parentHadronFlag(match); // 3 = light, 4 = charm, 5 = b
                         break;
                     case MElectron:
                         if (match->isPromptFinalState()) flav[i] = (match->pdgId() == 22 ? 22 : 1); // prompt electron or photon
                         else if (match->isDirectPromptTauDecayProductFinalState()) flav[i] = 15; // tau
-                        else flav[i] = getParentHadronFlag(match); // 3 = light, 4 = charm, 5 = b
+                        else flav[i] = parentHadronFlag(match); // 3 = light, 4 = charm, 5 = b
                         break;
                     case MPhoton:
                         if (match->isPromptFinalState()) flav[i] = (match->pdgId() == 22 ? 1 : 13); // prompt electron or photon
@@ -134,6 +150,7 @@ class CandMCMatchTableProducer : public edm::global::EDProducer<> {
             desc.add<edm::InputTag>("mcMap")->setComment("tag to an edm::Association<GenParticleCollection> mapping src to gen, such as the one produced by MCMatcher");
             desc.add<std::string>("objType")->setComment("type of object to match (Muon, Electron, Tau, Photon, Other), taylors what's in t Flav branch");
             desc.addOptional<edm::InputTag>("mcMapVisTau")->setComment("as mcMap, but pointing to the visible gen taus (only if objType == Tau)");
+            desc.addOptional<edm::InputTag>("genHistory")->setComment("GenHistory of the matched gen particles, to avoid walking the mothers of each match");
             descriptions.add("candMcMatchTable", desc);
         }
 
@@ -142,6 +159,7 @@ class CandMCMatchTableProducer : public edm::global::EDProducer<> {
         const edm::EDGetTokenT<reco::CandidateView> src_;
         const edm::EDGetTokenT<edm::Association<reco::GenParticleCollection>> candMap_;
         edm::EDGetTokenT<edm::Association<reco::GenParticleCollection>> candMapVisTau_;
+        edm::EDGetTokenT<GenHistory> genHistory_;
         enum MatchType { MMuon, MElectron, MTau, MPhoton, MOther } type_;
         std::string flavDoc_;
 };
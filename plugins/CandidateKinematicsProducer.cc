@@ -0,0 +1,43 @@
+#include "FWCore/Framework/interface/global/EDProducer.h"
+#include "FWCore/Framework/interface/Event.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/ParameterSet/interface/ConfigurationDescriptions.h"
+#include "FWCore/ParameterSet/interface/ParameterSetDescription.h"
+#include "DataFormats/Common/interface/View.h"
+#include "DataFormats/Candidate/interface/Candidate.h"
+#include "PhysicsTools/NanoAOD/interface/CandidateKinematics.h"
+
+/// Copies the kinematics of a collection of candidates into flat arrays, once per event, for the modules that need only those
+class CandidateKinematicsProducer : public edm::global::EDProducer<> {
+    public:
+        CandidateKinematicsProducer( edm::ParameterSet const & params ) :
+            src_(consumes<edm::View<reco::Candidate>>(params.getParameter<edm::InputTag>("src")))
+        {
+            produces<CandidateKinematics>();
+        }
+
+        ~CandidateKinematicsProducer() override {}
+
+        void produce(edm::StreamID, edm::Event& iEvent, const edm::EventSetup& iSetup) const override {
+            edm::Handle<edm::View<reco::Candidate>> src;
+            iEvent.getByToken(src_, src);
+
+            auto out = std::make_unique<CandidateKinematics>();
+            out->fill(*src);
+            out->setId(src.id());
+
+            iEvent.put(std::move(out));
+        }
+
+        static void fillDescriptions(edm::ConfigurationDescriptions & descriptions) {
+            edm::ParameterSetDescription desc;
+            desc.add<edm::InputTag>("src")->setComment("candidates, in the order of the output arrays");
+            descriptions.add("candidateKinematics", desc);
+        }
+
+    protected:
+        const edm::EDGetTokenT<edm::View<reco::Candidate>> src_;
+};
+
+#include "FWCore/Framework/interface/MakerMacros.h"
+DEFINE_FWK_MODULE(CandidateKinematicsProducer);
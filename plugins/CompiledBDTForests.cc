@@ -0,0 +1,3 @@
+// The forests of the weight files listed in data/compiledBDT.txt, generated during the build by scripts/nanoCompileBDT.py
+// (see the makefile rules in BuildFile.xml)
+#include "CompiledBDTForests.h"
@@ -0,0 +1,118 @@
+#include "FWCore/Framework/interface/global/EDProducer.h"
+#include "FWCore/Framework/interface/Event.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/ParameterSet/interface/ConfigurationDescriptions.h"
+#include "FWCore/ParameterSet/interface/ParameterSetDescription.h"
+#include "DataFormats/Common/interface/View.h"
+#include "DataFormats/Candidate/interface/Candidate.h"
+#include "CommonTools/Utils/interface/StringCutObjectSelector.h"
+#include "PhysicsTools/NanoAOD/interface/FlatTable.h"
+#include "PhysicsTools/NanoAOD/interface/CandidateKinematics.h"
+#include "PhysicsTools/NanoAOD/interface/MatchingUtils.h"
+
+#include <vector>
+#include <cmath>
+
+/// deltaR matching of the objects of one table (src) to the objects of another one (matchTo),
+/// written as an extension of the first table: <name>_<matchName>Idx and <name>_<matchName>DeltaR.
+/// The indices refer to the objects of matchTo passing matchCut, i.e. to the rows of a table made from matchTo with the same cut.
+class DeltaRMatchTableProducer : public edm::global::EDProducer<> {
+    public:
+        DeltaRMatchTableProducer( edm::ParameterSet const & params ) :
+            name_(params.getParameter<std::string>("name")),
+            matchName_(params.getParameter<std::string>("matchName")),
+            src_(consumes<reco::CandidateView>(params.getParameter<edm::InputTag>("src"))),
+            matchTo_(consumes<reco::CandidateView>(params.getParameter<edm::InputTag>("matchTo"))),
+            cut_(params.getParameter<std::string>("cut"), true),
+            matchCut_(params.getParameter<std::string>("matchCut"), true),
+            maxDeltaR_(params.getParameter<double>("maxDeltaR")),
+            ptWeight_(params.getParameter<double>("ptWeight")),
+            precision_(params.getParameter<int>("precision"))
+        {
+            const std::string & strategy = params.getParameter<std::string>("strategy");
+            if (strategy == "closest") strategy_ = Closest;
+            else if (strategy == "unique") strategy_ = Unique;
+            else if (strategy == "ptWeighted") strategy_ = PtWeighted;
+            else throw cms::Exception("Configuration", "Unsupported strategy '"+strategy+"'\n");
+            if (maxDeltaR_ <= 0) throw cms::Exception("Configuration", "maxDeltaR must be positive\n");
+            produces<FlatTable>();
+        }
+
+        ~DeltaRMatchTableProducer() override {}
+
+        void produce(edm::StreamID id, edm::Event& iEvent, const edm::EventSetup& iSetup) const override {
+            edm::Handle<reco::CandidateView> src, matchTo;
+            iEvent.getByToken(src_, src);
+            iEvent.getByToken(matchTo_, matchTo);
+
+            CandidateKinematics kinA, kinB;
+            std::vector<unsigned int> rowsA; // rows of the table whose objects pass the cut
+            for (unsigned int i = 0, n = src->size(); i < n; ++i) {
+                const auto & obj = (*src)[i];
+                if (cut_(obj)) { rowsA.push_back(i); kinA.push_back(obj.pt(), obj.eta(), obj.phi(), obj.mass(), obj.charge()); }
+            }
+            for (const auto & obj : *matchTo) {
+                if (matchCut_(obj)) kinB.push_back(obj.pt(), obj.eta(), obj.phi(), obj.mass(), obj.charge());
+            }
+
+            const float maxDR2 = maxDeltaR_*maxDeltaR_;
+            matching::EtaPhiGrid grid(kinB.eta().data(), kinB.phi().data(), kinB.size(), maxDeltaR_);
+            std::vector<int> matchA(kinA.size(), -1);
+            switch (strategy_) {
+                case Closest:
+                    for (unsigned int i = 0, n = kinA.size(); i < n; ++i) {
+                        matchA[i] = matching::bestMatch(kinA.eta()[i], kinA.phi()[i], grid, maxDR2, [](unsigned int) { return true; }).first;
+                    }
+                    break;
+                case Unique:
+                    matchA = matching::greedyUniqueMatch(kinA.eta().data(), kinA.phi().data(), kinA.size(), grid, kinB.size(), maxDR2);
+                    break;
+                case PtWeighted:
+                    // minimize deltaR^2 + (ptWeight * (ptB - ptA)/ptA)^2 among the objects within the cone
+                    for (unsigned int i = 0, n = kinA.size(); i < n; ++i) {
+                        matchA[i] = matching::ptWeightedMatch(kinA.eta()[i], kinA.phi()[i], kinA.pt()[i], grid, kinB.pt().data(), maxDR2, ptWeight_);
+                    }
+                    break;
+            }
+
+            unsigned int nrows = src->size();
+            std::vector<int> idx(nrows, -1);
+            std::vector<float> dr(nrows, -1);
+            for (unsigned int i = 0, n = kinA.size(); i < n; ++i) {
+                if (matchA[i] < 0) continue;
+                idx[rowsA[i]] = matchA[i];
+                dr[rowsA[i]] = std::sqrt(kinA.deltaR2(i, kinB.eta()[matchA[i]], kinB.phi()[matchA[i]]));
+            }
+
+            auto tab = std::make_unique<FlatTable>(nrows, name_, false, true);
+            tab->addColumn<int>(matchName_+"Idx", idx, "index of the matched "+matchName_+" (-1 if none)", FlatTable::IntColumn);
+            tab->addColumn<float>(matchName_+"DeltaR", dr, "deltaR to the matched "+matchName_+" (-1 if none)", FlatTable::FloatColumn, precision_);
+            iEvent.put(std::move(tab));
+        }
+
+        static void fillDescriptions(edm::ConfigurationDescriptions & descriptions) {
+            edm::ParameterSetDescription desc;
+            desc.add<std::string>("name")->setComment("name of the table to extend (the rows are the objects of src)");
+            desc.add<std::string>("matchName")->setComment("name of the matched table, used for the column names");
+            desc.add<edm::InputTag>("src")->setComment("objects of the table to extend");
+            desc.add<edm::InputTag>("matchTo")->setComment("objects to match to");
+            desc.add<std::string>("cut", "")->setComment("objects of src failing the cut are left unmatched");
+            desc.add<std::string>("matchCut", "")->setComment("selection of the objects to match to, same as for their table");
+            desc.add<double>("maxDeltaR")->setComment("maximum deltaR of the match");
+            desc.add<std::string>("strategy", "closest")->setComment("closest: closest object, unique: closest pairs first with each object used at most once, ptWeighted: smallest deltaR^2 + (ptWeight*deltaPt/pt)^2");
+            desc.add<double>("ptWeight", 1.0)->setComment("weight of the relative pt difference in the ptWeighted strategy");
+            desc.add<int>("precision", 8)->setComment("mantissa bits of the deltaR column");
+            descriptions.add("deltaRMatchTable", desc);
+        }
+
+    protected:
+        const std::string name_, matchName_;
+        const edm::EDGetTokenT<reco::CandidateView> src_, matchTo_;
+        const StringCutObjectSelector<reco::Candidate> cut_, matchCut_;
+        const double maxDeltaR_, ptWeight_;
+        const int precision_;
+        enum Strategy { Closest, Unique, PtWeighted } strategy_;
+};
+
+#include "FWCore/Framework/interface/MakerMacros.h"
+DEFINE_FWK_MODULE(DeltaRMatchTableProducer);
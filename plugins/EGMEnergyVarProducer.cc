@@ -86,19 +86,15 @@ EGMEnergyVarProducer<T>::produce(edm::StreamID streamID, edm::Event& iEvent, con
   iEvent.getByToken(srcCorr_, srcCorr);
 
   unsigned nSrcRaw = srcRaw->size();
-  unsigned nSrcCorr = srcCorr->size();
 
-  std::vector<float> eCorr(nSrcCorr,-1);
+  std::vector<float> eCorr(nSrcRaw,-1);
 
+  auto bySuperCluster = [](const auto & c, std::vector<uint64_t> & keys) { parentSuperClusterKeys(c, keys); };
+  MatchingKeyIndex corrIndex(*srcCorr, bySuperCluster);
   for (uint ir = 0; ir<nSrcRaw; ir++){
-    auto egm_raw = srcRaw->ptrAt(ir);
-    for (uint ic = 0; ic<nSrcCorr; ic++){
-      auto egm_corr = srcCorr->ptrAt(ic);
-      if(matchByCommonParentSuperClusterRef(*egm_raw,*egm_corr)){
-          eCorr[ir] = egm_corr->energy()/egm_raw->energy();
-          break;
-      }
-    }
+    const auto & egm_raw = (*srcRaw)[ir];
+    int ic = corrIndex.firstMatch(egm_raw, bySuperCluster);
+    if (ic >= 0) eCorr[ir] = (*srcCorr)[ic].energy()/egm_raw.energy();
   }
 
   std::unique_ptr<edm::ValueMap<float>> eCorrV(new edm::ValueMap<float>());
@@ -2,7 +2,9 @@
 #define PhysicsTools_UtilAlgos_interface_EDFilterValueMapWrapper_h
 
 /**
- This is derived from EDFilterValueMapWrapper but rather than filtering it just stores a valuemap with the result
+ This is derived from EDFilterValueMapWrapper but rather than filtering it just stores a valuemap with the result.
+ Several working points can be evaluated at once with "extraFilterParams": bit 0 of the result is filterParams, bit i is extraFilterParams[i-1].
+ If "name" and "column" are set, the result is stored instead as a column of an extension FlatTable, with one row per object of src
 */
 
 #include "DataFormats/Common/interface/ValueMap.h"
@@ -10,6 +12,7 @@
 #include "FWCore/Common/interface/EventBase.h"
 #include "FWCore/Framework/interface/Event.h"
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "PhysicsTools/NanoAOD/interface/FlatTable.h"
 #include <boost/shared_ptr.hpp>
 
 namespace edm {
@@ -23,24 +26,43 @@ namespace edm {
     typename C::const_iterator  const_iterator;
 
     /// default contructor. Declares the output (type "C") and the filter (of type T, operates on C::value_type)
-    FilterValueMapWrapper(const edm::ParameterSet& cfg) : src_( consumes<C>(cfg.getParameter<edm::InputTag>("src")))
+    FilterValueMapWrapper(const edm::ParameterSet& cfg) : src_( consumes<C>(cfg.getParameter<edm::InputTag>("src"))),
+      tableName_(cfg.existsAs<std::string>("name") ? cfg.getParameter<std::string>("name") : ""),
+      column_(cfg.existsAs<std::string>("column") ? cfg.getParameter<std::string>("column") : ""),
+      doc_(cfg.existsAs<std::string>("doc") ? cfg.getParameter<std::string>("doc") : "")
     {
-      filter_ = boost::shared_ptr<T>( new T(cfg.getParameter<edm::ParameterSet>("filterParams")) );
-      produces<edm::ValueMap<int>>();
+      filters_.push_back( boost::shared_ptr<T>( new T(cfg.getParameter<edm::ParameterSet>("filterParams")) ) );
+      if (cfg.existsAs<std::vector<edm::ParameterSet>>("extraFilterParams")) {
+        for (const edm::ParameterSet & pset : cfg.getParameter<std::vector<edm::ParameterSet>>("extraFilterParams")) {
+          filters_.push_back( boost::shared_ptr<T>( new T(pset) ) );
+        }
+      }
+      if (tableName_.empty() != column_.empty()) throw cms::Exception("Configuration", "FilterValueMapWrapper: 'name' and 'column' must be set together");
+      if (tableName_.empty()) produces<edm::ValueMap<int>>();
+      else produces<FlatTable>();
     }
     /// default destructor
     ~FilterValueMapWrapper() override{}
     /// everything which has to be done during the event loop. NOTE: We can't use the eventSetup in FWLite so ignore it
     void produce(edm::Event& event, const edm::EventSetup& eventSetup) override {
-      // create a collection of the objects to put into the event
-      auto objsToPut = std::make_unique<C>();
       // get the handle to the objects in the event.
       edm::Handle<C> h_c;
       event.getByToken( src_, h_c );
       std::vector<int> bitOut;
+      bitOut.reserve(h_c->size());
       // loop through and add passing value_types to the output vector
       for ( typename C::const_iterator ibegin = h_c->begin(), iend = h_c->end(), i = ibegin; i != iend; ++i ){
-	bitOut.push_back((*filter_)(*i));
+	int bits = 0;
+	for (unsigned int ifilter = 0, nfilters = filters_.size(); ifilter < nfilters; ++ifilter) {
+	  if ((*filters_[ifilter])(*i)) bits |= (1 << ifilter);
+	}
+	bitOut.push_back(bits);
+      }
+      if (!tableName_.empty()) {
+        auto tab = std::make_unique<FlatTable>(bitOut.size(), tableName_, false, true);
+        tab->addColumn<int>(column_, bitOut, doc_, FlatTable::IntColumn);
+        event.put(std::move(tab));
+        return;
       }
       std::unique_ptr<edm::ValueMap<int>> o(new edm::ValueMap<int>());
       edm::ValueMap<int>::Filler filler(*o);
@@ -52,8 +74,11 @@ namespace edm {
   protected:
     /// InputTag of the input source
     edm::EDGetTokenT<C> src_;
-    /// shared pointer to analysis class of type BasicAnalyzer
-    boost::shared_ptr<T> filter_;
+    /// shared pointers to analysis classes of type BasicAnalyzer, one per bit of the output.
+    /// The selectors count their cut flow, so they can't be shared between streams and this is a stream module
+    std::vector<boost::shared_ptr<T>> filters_;
+    /// table and column names, if the output is a FlatTable instead of a ValueMap
+    std::string tableName_, column_, doc_;
   };
 
 }
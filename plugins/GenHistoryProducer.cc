@@ -0,0 +1,42 @@
+#include "FWCore/Framework/interface/global/EDProducer.h"
+#include "FWCore/Framework/interface/Event.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/ParameterSet/interface/ConfigurationDescriptions.h"
+#include "FWCore/ParameterSet/interface/ParameterSetDescription.h"
+#include "DataFormats/HepMCCandidate/interface/GenParticle.h"
+#include "DataFormats/HepMCCandidate/interface/GenParticleFwd.h"
+#include "PhysicsTools/NanoAOD/interface/GenHistory.h"
+
+/// Computes the ancestry of the particles of a GenParticle collection once per event, for the MC matching and gen table producers
+class GenHistoryProducer : public edm::global::EDProducer<> {
+    public:
+        GenHistoryProducer( edm::ParameterSet const & params ) :
+            src_(consumes<reco::GenParticleCollection>(params.getParameter<edm::InputTag>("src")))
+        {
+            produces<GenHistory>();
+        }
+
+        ~GenHistoryProducer() override {}
+
+        void produce(edm::StreamID, edm::Event& iEvent, const edm::EventSetup& iSetup) const override {
+            edm::Handle<reco::GenParticleCollection> src;
+            iEvent.getByToken(src_, src);
+
+            auto out = std::make_unique<GenHistory>();
+            out->fill(*src, src.id());
+
+            iEvent.put(std::move(out));
+        }
+
+        static void fillDescriptions(edm::ConfigurationDescriptions & descriptions) {
+            edm::ParameterSetDescription desc;
+            desc.add<edm::InputTag>("src")->setComment("gen particle collection");
+            descriptions.add("genHistory", desc);
+        }
+
+    protected:
+        const edm::EDGetTokenT<reco::GenParticleCollection> src_;
+};
+
+#include "FWCore/Framework/interface/MakerMacros.h"
+DEFINE_FWK_MODULE(GenHistoryProducer);
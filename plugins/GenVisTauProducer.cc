@@ -10,7 +10,8 @@
 #include "DataFormats/JetReco/interface/GenJetCollection.h"
 #include "PhysicsTools/JetMCUtils/interface/JetMCTag.h"
 #include "DataFormats/TauReco/interface/PFTau.h"
-#include "DataFormats/Math/interface/deltaR.h"
+#include "PhysicsTools/NanoAOD/interface/MatchingUtils.h"
+#include "PhysicsTools/NanoAOD/interface/GenHistory.h"
 
 #include <vector>
 #include <iostream>
@@ -22,6 +23,9 @@ class GenVisTauProducer : public edm::global::EDProducer<>
     : src_(consumes<reco::GenJetCollection>(params.getParameter<edm::InputTag>("src")))
     , srcGenParticles_(consumes<reco::GenParticleCollection>(params.getParameter<edm::InputTag>("srcGenParticles")))
   {
+    if (params.existsAs<edm::InputTag>("genHistory")) {
+      genHistory_ = consumes<GenHistory>(params.getParameter<edm::InputTag>("genHistory"));
+    }
     produces<reco::GenParticleCollection>();
   }
   
@@ -36,6 +40,40 @@ class GenVisTauProducer : public edm::global::EDProducer<>
     evt.getByToken(srcGenParticles_, genParticles);
     size_t numGenParticles = genParticles->size();
 
+    // CV: visible momentum of the status 2 tau leptons, computed once and not once per tau jet
+    //     (or taken from the GenHistory of the gen particles, if available)
+    edm::Handle<GenHistory> history;
+    if (!genHistory_.isUninitialized()) evt.getByToken(genHistory_, history);
+    bool useHistory = history.isValid();
+    if ( useHistory && history->id() != genParticles.id() ) {
+      throw cms::Exception("Configuration", "The genHistory of GenVisTauProducer must be made from srcGenParticles\n");
+    }
+    std::vector<size_t> tauIndices;
+    std::vector<float> tauVisEta, tauVisPhi;
+    for ( size_t idxGenParticle = 0; idxGenParticle < numGenParticles; ++idxGenParticle ) {
+      if ( useHistory ) {
+        if ( history->hasVisibleP4(idxGenParticle) ) {
+          tauIndices.push_back(idxGenParticle);
+          tauVisEta.push_back(history->visibleEta(idxGenParticle));
+          tauVisPhi.push_back(history->visiblePhi(idxGenParticle));
+        }
+        continue;
+      }
+      const reco::GenParticle & genTau = (*genParticles)[idxGenParticle];
+      if ( abs(genTau.pdgId()) == 15 && genTau.status() == 2 ) {
+        reco::Candidate::LorentzVector daughterVisP4;
+        for (const reco::GenParticleRef & daughter : genTau.daughterRefVector()) {
+          int abs_pdgId = abs(daughter->pdgId());
+          // CV: skip neutrinos
+          if ( abs_pdgId == 12 || abs_pdgId == 14 || abs_pdgId == 16 ) continue;
+          daughterVisP4 += daughter->p4();
+        }
+        tauIndices.push_back(idxGenParticle);
+        tauVisEta.push_back(daughterVisP4.eta());
+        tauVisPhi.push_back(daughterVisP4.phi());
+      }
+    }
+
     auto genVisTaus = std::make_unique<reco::GenParticleCollection>();
 
     for (const auto & genTauJet : *genTauJets) {
@@ -55,23 +93,10 @@ class GenVisTauProducer : public edm::global::EDProducer<>
       // CV: store decayMode in status flag of GenParticle object
       reco::GenParticle genVisTau(genTauJet.charge(), genTauJet.p4(), genTauJet.vertex(), pdgId, decayMode, true);
 
-      // CV: find tau lepton "mother" particle
-      for ( size_t idxGenParticle = 0; idxGenParticle < numGenParticles; ++idxGenParticle ) {
-	const reco::GenParticle & genTau = (*genParticles)[idxGenParticle];
-	if ( abs(genTau.pdgId()) == 15 && genTau.status() == 2 ) {
-	  reco::Candidate::LorentzVector daughterVisP4;
-          for (const reco::GenParticleRef & daughter : genTau.daughterRefVector()) {
-	    int abs_pdgId = abs(daughter->pdgId());
-	    // CV: skip neutrinos
-	    if ( abs_pdgId == 12 || abs_pdgId == 14 || abs_pdgId == 16 ) continue;
-	    daughterVisP4 += daughter->p4();
-	  }
-	  double dR2 = deltaR2(daughterVisP4, genVisTau);
-	  if ( dR2 < 1.e-4 ) {	  
-	    genVisTau.addMother(reco::GenParticleRef(genParticles, idxGenParticle));
-	    break;
-	  }
-	}
+      // CV: find tau lepton "mother" particle (the first one in the collection, if several match)
+      std::vector<unsigned int> matches = matching::withinCone(genVisTau.eta(), genVisTau.phi(), tauVisEta.data(), tauVisPhi.data(), tauIndices.size(), 1.e-4);
+      if ( !matches.empty() ) {
+        genVisTau.addMother(reco::GenParticleRef(genParticles, tauIndices[matches.front()]));
       }
 
       genVisTaus->push_back(genVisTau);
@@ -84,6 +109,7 @@ class GenVisTauProducer : public edm::global::EDProducer<>
       edm::ParameterSetDescription desc;
       desc.add<edm::InputTag>("src")->setComment("collection of visible gen taus (as reco::GenJetCollection)");
       desc.add<edm::InputTag>("srcGenParticles")->setComment("collections of gen particles");
+      desc.addOptional<edm::InputTag>("genHistory")->setComment("GenHistory of srcGenParticles, providing the visible momentum of the taus");
       descriptions.add("genVisTaus", desc);
   }
 
@@ -91,6 +117,7 @@ class GenVisTauProducer : public edm::global::EDProducer<>
  private:
   const edm::EDGetTokenT<reco::GenJetCollection> src_;
   const edm::EDGetTokenT<reco::GenParticleCollection> srcGenParticles_;
+  edm::EDGetTokenT<GenHistory> genHistory_;
 };
 
 #include "FWCore/Framework/interface/MakerMacros.h"
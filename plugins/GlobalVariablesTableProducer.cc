@@ -1,14 +1,18 @@
-#include "FWCore/Framework/interface/stream/EDProducer.h"
+#include "FWCore/Framework/interface/global/EDProducer.h"
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
 #include "PhysicsTools/NanoAOD/interface/FlatTable.h"
 #include "FWCore/Framework/interface/ConsumesCollector.h"
 #include "DataFormats/Candidate/interface/Candidate.h"
+#include "CommonTools/Utils/interface/StringCutObjectSelector.h"
 
 #include <utility>
 #include <vector>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <boost/ptr_container/ptr_vector.hpp>
 
-class GlobalVariablesTableProducer : public edm::stream::EDProducer<> {
+class GlobalVariablesTableProducer : public edm::global::EDProducer<> {
     public:
 
         GlobalVariablesTableProducer( edm::ParameterSet const & params )
@@ -21,8 +25,11 @@ class GlobalVariablesTableProducer : public edm::stream::EDProducer<> {
                 else if (type == "float") vars_.push_back(new FloatVar(vname, FlatTable::FloatColumn, varPSet, consumesCollector()));
                 else if (type == "double") vars_.push_back(new DoubleVar(vname, FlatTable::FloatColumn, varPSet, consumesCollector()));
                 else if (type == "bool") vars_.push_back(new BoolVar(vname, FlatTable::UInt8Column, varPSet, consumesCollector()));
-                else if (type == "candidatescalarsum") vars_.push_back(new CandidateScalarSumVar(vname, FlatTable::FloatColumn, varPSet, consumesCollector()));
-                else if (type == "candidatesize") vars_.push_back(new CandidateSizeVar(vname, FlatTable::IntColumn, varPSet, consumesCollector()));
+                else if (type == "candidatescalarsum") addAggregate(vname, FlatTable::FloatColumn, CandidateReduction::ScalarPtSum, varPSet);
+                else if (type == "candidatevectorsum") addAggregate(vname, FlatTable::FloatColumn, CandidateReduction::VectorPtSum, varPSet);
+                else if (type == "candidatemaxpt") addAggregate(vname, FlatTable::FloatColumn, CandidateReduction::MaxPt, varPSet);
+                else if (type == "candidateminpt") addAggregate(vname, FlatTable::FloatColumn, CandidateReduction::MinPt, varPSet);
+                else if (type == "candidatesize") addAggregate(vname, FlatTable::IntColumn, CandidateReduction::Count, varPSet);
                 else throw cms::Exception("Configuration", "unsupported type "+type+" for variable "+vname);
             }
 
@@ -31,10 +38,14 @@ class GlobalVariablesTableProducer : public edm::stream::EDProducer<> {
 
         ~GlobalVariablesTableProducer() override {}
 
-        void produce(edm::Event& iEvent, const edm::EventSetup& iSetup) override {
+        void produce(edm::StreamID, edm::Event& iEvent, const edm::EventSetup& iSetup) const override {
             auto out = std::make_unique<FlatTable>(1, "", true);
 
-            for (const auto & var : vars_) var.fill(iEvent, *out);
+            // all the aggregates over the same collection are computed together, in a single pass over the collection
+            std::vector<std::vector<double>> reduced(reductions_.size());
+            for (unsigned int ir = 0, nr = reductions_.size(); ir < nr; ++ir) reductions_[ir].reduce(iEvent, reduced[ir]);
+
+            for (const auto & var : vars_) var.fill(iEvent, reduced, *out);
 
             iEvent.put(std::move(out));
         }
@@ -44,7 +55,7 @@ class GlobalVariablesTableProducer : public edm::stream::EDProducer<> {
             public:
                 Variable(const std::string & aname, FlatTable::ColumnType atype, const edm::ParameterSet & cfg) : 
                     name_(aname), doc_(cfg.getParameter<std::string>("doc")), type_(atype) {}
-                virtual void fill(const edm::Event &iEvent, FlatTable & out) const = 0;
+                virtual void fill(const edm::Event &iEvent, const std::vector<std::vector<double>> & reduced, FlatTable & out) const = 0;
                 virtual ~Variable() {}
                 const std::string & name() const { return name_; }
                 const FlatTable::ColumnType & type() const { return type_; }
@@ -58,53 +69,6 @@ class GlobalVariablesTableProducer : public edm::stream::EDProducer<> {
 			static ValType convert(ValType x){return x;}
 			
 	};
-	template <typename ValType>
-	class Size {
-		public:
-			static int convert(ValType x){return x.size();}
-			
-	};
-
-	template <typename ColType,typename ValType>
-	class Max {
-		public:
-			static ColType convert(ValType x){
-				ColType v=std::numeric_limits<ColType>::min();
-				for(const auto & i : x) if(i>v) v=i;
-				return v;
-			}
-        };
-	template <typename ColType,typename ValType>
-        class Min {
-                public:
-                        static ColType convert(ValType x){
-                                ColType v=std::numeric_limits<ColType>::max(); 
-                                for(const auto & i : x) if(i<v) v=i;
-                                return v;
-                        }
-        };
-	template <typename ColType,typename ValType>
-        class ScalarPtSum {
-                public:
-                        static ColType convert(ValType x){
-                                ColType v=0;
-                                for(const auto & i : x) v+=i.pt();
-                                return v;
-                        }
-        };
-	template <typename ColType,typename ValType>
-        class PtVectorSum {
-                public:
-                        static ColType convert(ValType x){
-				if(x.size()==0) return 0;
-                                auto v=x[0].p4();
-				v-=x[0].p4();
-                                for(const auto & i : x) v+=i.p4();
-                                return v.pt();
-                        }
-        };
-
-
 
         template<typename ValType, typename ColType=ValType,  typename Converter=Identity<ValType> >
             class VariableT : public Variable {
@@ -112,7 +76,7 @@ class GlobalVariablesTableProducer : public edm::stream::EDProducer<> {
                     VariableT(const std::string & aname, FlatTable::ColumnType atype, const edm::ParameterSet & cfg, edm::ConsumesCollector && cc) :
                         Variable(aname, atype, cfg), src_(cc.consumes<ValType>(cfg.getParameter<edm::InputTag>("src"))) {}
                     ~VariableT() override {}
-                    void fill(const edm::Event &iEvent, FlatTable & out) const override {
+                    void fill(const edm::Event &iEvent, const std::vector<std::vector<double>> &, FlatTable & out) const override {
                         edm::Handle<ValType> handle;
                         iEvent.getByToken(src_, handle);
                         out.template addColumnValue<ColType>(this->name_, Converter::convert(*handle), this->doc_, this->type_);
@@ -124,9 +88,104 @@ class GlobalVariablesTableProducer : public edm::stream::EDProducer<> {
         typedef VariableT<float> FloatVar;
         typedef VariableT<double,float> DoubleVar;
         typedef VariableT<bool,uint8_t> BoolVar;
-        typedef VariableT<edm::View<reco::Candidate>,float,ScalarPtSum<float,edm::View<reco::Candidate>>> CandidateScalarSumVar;
-        typedef VariableT<edm::View<reco::Candidate>,int,Size<edm::View<reco::Candidate>>> CandidateSizeVar;
+
+        /// aggregates (sums, extrema, counts) of the candidates of one collection, each with an optional cut
+        class CandidateReduction {
+            public:
+                enum Kind { ScalarPtSum, VectorPtSum, MaxPt, MinPt, Count };
+                CandidateReduction(const edm::InputTag & src, edm::ConsumesCollector && cc) :
+                    src_(src), token_(cc.consumes<edm::View<reco::Candidate>>(src)), needsPxPy_(false) {}
+                const edm::InputTag & src() const { return src_; }
+                /// returns the index of the result of this aggregate in the output of reduce
+                unsigned int add(Kind kind, const std::string & cut) {
+                    int icut = -1;
+                    if (!cut.empty()) {
+                        // aggregates with the same cut share the selection
+                        auto match = std::find(cutStrings_.begin(), cutStrings_.end(), cut);
+                        icut = match - cutStrings_.begin();
+                        if (match == cutStrings_.end()) { 
+                            cutStrings_.push_back(cut); 
+                            cuts_.push_back(new StringCutObjectSelector<reco::Candidate>(cut, true));
+                        }
+                    }
+                    if (kind == VectorPtSum) needsPxPy_ = true;
+                    aggregates_.emplace_back(kind, icut);
+                    return aggregates_.size()-1;
+                }
+                void reduce(const edm::Event & iEvent, std::vector<double> & results) const {
+                    edm::Handle<edm::View<reco::Candidate>> cands;
+                    iEvent.getByToken(token_, cands);
+                    unsigned int n = cands->size();
+                    // first copy what is needed from the candidates into flat arrays, evaluating all the cuts 
+                    std::vector<double> pt(n), px(needsPxPy_ ? n : 0), py(needsPxPy_ ? n : 0);
+                    std::vector<std::vector<uint8_t>> pass(cuts_.size(), std::vector<uint8_t>(n));
+                    for (unsigned int i = 0; i < n; ++i) {
+                        const reco::Candidate & c = (*cands)[i];
+                        pt[i] = c.pt();
+                        if (needsPxPy_) { px[i] = c.px(); py[i] = c.py(); }
+                        for (unsigned int ic = 0, nc = cuts_.size(); ic < nc; ++ic) pass[ic][i] = cuts_[ic](c);
+                    }
+                    // then run the reductions on the arrays, which the compiler can vectorize
+                    results.resize(aggregates_.size());
+                    for (unsigned int ia = 0, na = aggregates_.size(); ia < na; ++ia) {
+                        const uint8_t * sel = aggregates_[ia].second >= 0 ? pass[aggregates_[ia].second].data() : nullptr;
+                        switch (aggregates_[ia].first) {
+                            case ScalarPtSum: results[ia] = sum(pt, sel, n); break;
+                            case VectorPtSum: results[ia] = std::hypot(sum(px, sel, n), sum(py, sel, n)); break;
+                            case MaxPt: results[ia] = maxPt(pt, sel, n); break;
+                            case MinPt: results[ia] = minPt(pt, sel, n); break;
+                            case Count: results[ia] = sel ? std::count(sel, sel+n, 1) : n; break;
+                        }
+                    }
+                }
+            private:
+                static double sum(const std::vector<double> & x, const uint8_t * sel, unsigned int n) {
+                    double ret = 0;
+                    if (sel) { for (unsigned int i = 0; i < n; ++i) ret += sel[i] ? x[i] : 0.0; }
+                    else     { for (unsigned int i = 0; i < n; ++i) ret += x[i]; }
+                    return ret;
+                }
+                // the extrema of an empty selection are set to zero
+                static double maxPt(const std::vector<double> & pt, const uint8_t * sel, unsigned int n) {
+                    double ret = 0;
+                    for (unsigned int i = 0; i < n; ++i) ret = std::max(ret, (!sel || sel[i]) ? pt[i] : 0.0);
+                    return ret;
+                }
+                static double minPt(const std::vector<double> & pt, const uint8_t * sel, unsigned int n) {
+                    double ret = std::numeric_limits<double>::max();
+                    for (unsigned int i = 0; i < n; ++i) ret = std::min(ret, (!sel || sel[i]) ? pt[i] : std::numeric_limits<double>::max());
+                    return ret == std::numeric_limits<double>::max() ? 0 : ret;
+                }
+                edm::InputTag src_;
+                edm::EDGetTokenT<edm::View<reco::Candidate>> token_;
+                bool needsPxPy_;
+                std::vector<std::string> cutStrings_;
+                boost::ptr_vector<StringCutObjectSelector<reco::Candidate>> cuts_;
+                std::vector<std::pair<Kind,int>> aggregates_; // kind, index of the cut (or -1)
+        };
+        class CandidateAggregateVar : public Variable {
+            public:
+                CandidateAggregateVar(const std::string & aname, FlatTable::ColumnType atype, const edm::ParameterSet & cfg, unsigned int reduction, unsigned int index) :
+                    Variable(aname, atype, cfg), reduction_(reduction), index_(index) {}
+                void fill(const edm::Event &, const std::vector<std::vector<double>> & reduced, FlatTable & out) const override {
+                    double val = reduced[reduction_][index_];
+                    if (this->type_ == FlatTable::IntColumn) out.template addColumnValue<int>(this->name_, int(val), this->doc_, this->type_);
+                    else out.template addColumnValue<float>(this->name_, float(val), this->doc_, this->type_);
+                }
+            protected:
+                unsigned int reduction_, index_;
+        };
+        void addAggregate(const std::string & vname, FlatTable::ColumnType type, CandidateReduction::Kind kind, const edm::ParameterSet & varPSet) {
+            const edm::InputTag & src = varPSet.getParameter<edm::InputTag>("src");
+            const std::string & cut = varPSet.existsAs<std::string>("cut") ? varPSet.getParameter<std::string>("cut") : "";
+            unsigned int ir = 0, nr = reductions_.size();
+            while (ir < nr && !(reductions_[ir].src() == src)) ++ir;
+            if (ir == nr) reductions_.push_back(new CandidateReduction(src, consumesCollector()));
+            vars_.push_back(new CandidateAggregateVar(vname, type, varPSet, ir, reductions_[ir].add(kind, cut)));
+        }
+
         boost::ptr_vector<Variable> vars_;
+        boost::ptr_vector<CandidateReduction> reductions_;
 };
 
 #include "FWCore/Framework/interface/MakerMacros.h"
@@ -93,9 +93,9 @@ class IsoValueMapProducer : public edm::global::EDProducer<> {
   std::unique_ptr<EffectiveAreas> ea_pfiso_neu_;
   std::unique_ptr<EffectiveAreas> ea_pfiso_pho_;
   float getEtaForEA(const T*) const;
-  void doMiniIso(edm::Event&) const;
-  void doPFIsoEle(edm::Event&) const;
-  void doPFIsoPho(edm::Event&) const;
+  void doMiniIso(edm::Event&, const edm::Handle<edm::View<T>> &) const;
+  void doPFIsoEle(edm::Event&, const edm::Handle<edm::View<T>> &) const;
+  void doPFIsoPho(edm::Event&, const edm::Handle<edm::View<T>> &) const;
 
 };
 
@@ -122,19 +122,19 @@ template <typename T>
 void
 IsoValueMapProducer<T>::produce(edm::StreamID streamID, edm::Event& iEvent, const edm::EventSetup& iSetup) const
 {
+  edm::Handle<edm::View<T>> src;
+  iEvent.getByToken(src_, src);
 
-  if ((typeid(T) == typeid(pat::Muon)) || (typeid(T) == typeid(pat::Electron)) || typeid(T) == typeid(pat::IsolatedTrack)) { doMiniIso(iEvent); };
-  if ((typeid(T) == typeid(pat::Electron))) { doPFIsoEle(iEvent); }
-  if ((typeid(T) == typeid(pat::Photon))) { doPFIsoPho(iEvent); }
+  if ((typeid(T) == typeid(pat::Muon)) || (typeid(T) == typeid(pat::Electron)) || typeid(T) == typeid(pat::IsolatedTrack)) { doMiniIso(iEvent, src); };
+  if ((typeid(T) == typeid(pat::Electron))) { doPFIsoEle(iEvent, src); }
+  if ((typeid(T) == typeid(pat::Photon))) { doPFIsoPho(iEvent, src); }
 
 }
 
 template<typename T>
 void
-IsoValueMapProducer<T>::doMiniIso(edm::Event& iEvent) const{
+IsoValueMapProducer<T>::doMiniIso(edm::Event& iEvent, const edm::Handle<edm::View<T>> & src) const{
 
-  edm::Handle<edm::View<T>> src;
-  iEvent.getByToken(src_, src);
   edm::Handle<double> rho;
   iEvent.getByToken(rho_miniiso_,rho);
 
@@ -172,19 +172,17 @@ IsoValueMapProducer<T>::doMiniIso(edm::Event& iEvent) const{
 
 template<>
 void
-IsoValueMapProducer<pat::Photon>::doMiniIso(edm::Event& iEvent) const {}
+IsoValueMapProducer<pat::Photon>::doMiniIso(edm::Event& iEvent, const edm::Handle<edm::View<pat::Photon>> & src) const {}
 
 
 template<typename T>
 void
-IsoValueMapProducer<T>::doPFIsoEle(edm::Event& iEvent) const {}
+IsoValueMapProducer<T>::doPFIsoEle(edm::Event& iEvent, const edm::Handle<edm::View<T>> & src) const {}
 
 template<>
 void
-IsoValueMapProducer<pat::Electron>::doPFIsoEle(edm::Event& iEvent) const{
+IsoValueMapProducer<pat::Electron>::doPFIsoEle(edm::Event& iEvent, const edm::Handle<edm::View<pat::Electron>> & src) const{
 
-  edm::Handle<edm::View<pat::Electron>> src;
-  iEvent.getByToken(src_, src);
   edm::Handle<double> rho;
   iEvent.getByToken(rho_pfiso_,rho);
   
@@ -221,14 +219,12 @@ IsoValueMapProducer<pat::Electron>::doPFIsoEle(edm::Event& iEvent) const{
 
 template<typename T>
 void
-IsoValueMapProducer<T>::doPFIsoPho(edm::Event& iEvent) const {}
+IsoValueMapProducer<T>::doPFIsoPho(edm::Event& iEvent, const edm::Handle<edm::View<T>> & src) const {}
 
 template<>
 void
-IsoValueMapProducer<pat::Photon>::doPFIsoPho(edm::Event& iEvent) const {
+IsoValueMapProducer<pat::Photon>::doPFIsoPho(edm::Event& iEvent, const edm::Handle<edm::View<pat::Photon>> & src) const {
 
-  edm::Handle<edm::View<pat::Photon>> src;
-  iEvent.getByToken(src_, src);
   edm::Handle<double> rho;
   iEvent.getByToken(rho_pfiso_,rho);
   edm::Handle<edm::ValueMap<float> > mapIsoChg;
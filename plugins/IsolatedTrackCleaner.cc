@@ -5,6 +5,7 @@
 #include "DataFormats/Candidate/interface/Candidate.h"
 #include "DataFormats/PatCandidates/interface/IsolatedTrack.h"
 #include "DataFormats/Common/interface/RefToPtr.h"
+#include "DataFormats/Common/interface/RefVector.h"
 #include "CommonTools/Utils/interface/StringCutObjectSelector.h"
 
 #include <vector>
@@ -14,19 +15,22 @@ class IsolatedTrackCleaner : public edm::global::EDProducer<> {
     public:
         IsolatedTrackCleaner( edm::ParameterSet const & params ) :
             tracks_(consumes<std::vector<pat::IsolatedTrack>>(params.getParameter<edm::InputTag>("tracks"))),
-            cut_(params.getParameter<std::string>("cut"))
+            cut_(params.getParameter<std::string>("cut")),
+            refVector_(params.existsAs<bool>("refVector") ? params.getParameter<bool>("refVector") : false)
         {
             for (const edm::InputTag & tag : params.getParameter<std::vector<edm::InputTag>>("finalLeptons")) {
                 leptons_.push_back(consumes<reco::CandidateView>(tag));
             }
-            produces<std::vector<pat::IsolatedTrack>>();
+            // the selected tracks are either copied, or referred to by a RefVector into the input collection
+            // (in that case, ValueMaps filled from a View of the output are keyed on the RefVector, while the
+            // tables look them up with the product id of the input collection: refVector is not usable with isoTrackTable)
+            if (refVector_) produces<edm::RefVector<std::vector<pat::IsolatedTrack>>>();
+            else produces<std::vector<pat::IsolatedTrack>>();
         }
 
         ~IsolatedTrackCleaner() override {}
 
         void produce(edm::StreamID id, edm::Event& iEvent, const edm::EventSetup& iSetup) const override {
-            auto out  = std::make_unique<std::vector<pat::IsolatedTrack>>();
-
             std::vector<reco::CandidatePtr> leptonPfCands;
             edm::Handle<reco::CandidateView> leptons;
             for (const auto & token : leptons_) {
@@ -42,7 +46,9 @@ class IsolatedTrackCleaner : public edm::global::EDProducer<> {
 
             edm::Handle<std::vector<pat::IsolatedTrack>> tracks;
             iEvent.getByToken(tracks_, tracks);
-            for (const auto & track : *tracks) {
+            std::vector<unsigned int> selected;
+            for (unsigned int i = 0, n = tracks->size(); i < n; ++i) {
+                const auto & track = (*tracks)[i];
                 if (!cut_(track)) continue; 
                 if (track.packedCandRef().isNonnull()) {
                     reco::CandidatePtr pfCand(edm::refToPtr(track.packedCandRef()));
@@ -50,16 +56,26 @@ class IsolatedTrackCleaner : public edm::global::EDProducer<> {
                         continue;
                     }
                 }
-                out->push_back(track);
+                selected.push_back(i);
             }
 
-            iEvent.put(std::move(out));
+            if (refVector_) {
+                auto out = std::make_unique<edm::RefVector<std::vector<pat::IsolatedTrack>>>();
+                for (unsigned int i : selected) out->push_back(edm::Ref<std::vector<pat::IsolatedTrack>>(tracks, i));
+                iEvent.put(std::move(out));
+            } else {
+                auto out = std::make_unique<std::vector<pat::IsolatedTrack>>();
+                out->reserve(selected.size());
+                for (unsigned int i : selected) out->push_back((*tracks)[i]);
+                iEvent.put(std::move(out));
+            }
         }
 
     protected:
         edm::EDGetTokenT<std::vector<pat::IsolatedTrack>> tracks_;
         StringCutObjectSelector<pat::IsolatedTrack> cut_;
         std::vector<edm::EDGetTokenT<reco::CandidateView>> leptons_;
+        const bool refVector_;
 };
 
 #include "FWCore/Framework/interface/MakerMacros.h"
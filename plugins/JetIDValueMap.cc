@@ -1,7 +1,8 @@
 #include "PhysicsTools/NanoAOD/plugins/FilterValueMapWrapper.h"
 #include "PhysicsTools/SelectorUtils/interface/PFJetIDSelectionFunctor.h"
+#include "DataFormats/Common/interface/View.h"
 
-typedef edm::FilterValueMapWrapper<PFJetIDSelectionFunctor, std::vector<pat::Jet> > PatJetIDValueMapProducer;
+typedef edm::FilterValueMapWrapper<PFJetIDSelectionFunctor, edm::View<pat::Jet> > PatJetIDValueMapProducer;
 
 #include "FWCore/Framework/interface/MakerMacros.h"
 DEFINE_FWK_MODULE(PatJetIDValueMapProducer);
@@ -39,6 +39,7 @@
 #include "DataFormats/Common/interface/View.h"
 
 #include "PhysicsTools/NanoAOD/interface/MatchingUtils.h"
+#include "PhysicsTools/NanoAOD/interface/PackedCandidateTrackQuality.h"
 
 //
 // class declaration
@@ -52,6 +53,9 @@ class LeptonJetVarProducer : public edm::global::EDProducer<> {
     srcLep_(consumes<edm::View<T>>(iConfig.getParameter<edm::InputTag>("srcLep"))),
     srcVtx_(consumes<std::vector<reco::Vertex>>(iConfig.getParameter<edm::InputTag>("srcVtx")))
   {
+    if (iConfig.existsAs<edm::InputTag>("trackQuality")) {
+      trackQuality_ = consumes<PackedCandidateTrackQuality>(iConfig.getParameter<edm::InputTag>("trackQuality"));
+    }
     produces<edm::ValueMap<float>>("ptRatio");
     produces<edm::ValueMap<float>>("ptRel");
     produces<edm::ValueMap<float>>("jetNDauChargedMVASel");
@@ -64,13 +68,14 @@ class LeptonJetVarProducer : public edm::global::EDProducer<> {
    private:
   void produce(edm::StreamID, edm::Event&, const edm::EventSetup&) const override;
 
-  std::tuple<float,float,float> calculatePtRatioRel(auto &lep, auto &jet, auto &vtx) const;
+  std::tuple<float,float,float> calculatePtRatioRel(auto &lep, auto &jet, auto &vtx, const PackedCandidateTrackQuality * trackQuality) const;
 
       // ----------member data ---------------------------
 
   edm::EDGetTokenT<edm::View<pat::Jet>> srcJet_;
   edm::EDGetTokenT<edm::View<T>> srcLep_;
   edm::EDGetTokenT<std::vector<reco::Vertex>> srcVtx_;
+  edm::EDGetTokenT<PackedCandidateTrackQuality> trackQuality_;
 };
 
 //
@@ -99,7 +104,6 @@ LeptonJetVarProducer<T>::produce(edm::StreamID streamID, edm::Event& iEvent, con
   edm::Handle<std::vector<reco::Vertex>> srcVtx;
   iEvent.getByToken(srcVtx_, srcVtx);
 
-  unsigned nJet = srcJet->size();
   unsigned nLep = srcLep->size();
 
   std::vector<float> ptRatio(nLep,-1);
@@ -108,19 +112,23 @@ LeptonJetVarProducer<T>::produce(edm::StreamID streamID, edm::Event& iEvent, con
   std::vector<reco::CandidatePtr> jetForLepJetVar(nLep,reco::CandidatePtr());
 
   const auto & pv = (*srcVtx)[0];
+  // precomputed track quality of the jet daughters, if available (it must be computed with respect to the same vertex);
+  // the daughters it does not have are computed here
+  edm::Handle<PackedCandidateTrackQuality> trackQuality;
+  if (!trackQuality_.isUninitialized()) iEvent.getByToken(trackQuality_, trackQuality);
 
+  auto bySource = [](const auto & c, std::vector<uint64_t> & keys) { sourceCandidateKeys(c, keys); };
+  MatchingKeyIndex jetIndex(*srcJet, bySource);
   for (uint il = 0; il<nLep; il++){
-    for (uint ij = 0; ij<nJet; ij++){
+    int ij = jetIndex.firstMatch((*srcLep)[il], bySource); // take leading jet with shared source candidates
+    if (ij >= 0) {
       auto lep = srcLep->ptrAt(il);
       auto jet = srcJet->ptrAt(ij);
-      if(matchByCommonSourceCandidatePtr(*lep,*jet)){
-	  auto res = calculatePtRatioRel(lep,jet,pv);
-	  ptRatio[il] = std::get<0>(res);
-	  ptRel[il] = std::get<1>(res);
-	  jetNDauChargedMVASel[il] = std::get<2>(res);
-	  jetForLepJetVar[il] = jet;
-	  break; // take leading jet with shared source candidates
-	}
+      auto res = calculatePtRatioRel(lep,jet,pv,trackQuality.isValid() ? trackQuality.product() : nullptr);
+      ptRatio[il] = std::get<0>(res);
+      ptRel[il] = std::get<1>(res);
+      jetNDauChargedMVASel[il] = std::get<2>(res);
+      jetForLepJetVar[il] = jet;
     }
   }
 
@@ -153,7 +161,7 @@ LeptonJetVarProducer<T>::produce(edm::StreamID streamID, edm::Event& iEvent, con
 
 template <typename T>
 std::tuple<float,float,float>
-LeptonJetVarProducer<T>::calculatePtRatioRel(auto &lep, auto &jet, auto &vtx) const {
+LeptonJetVarProducer<T>::calculatePtRatioRel(auto &lep, auto &jet, auto &vtx, const PackedCandidateTrackQuality * trackQuality) const {
  
   auto rawp4_ = jet->correctedP4("Uncorrected");
   auto rawp4 = TLorentzVector(rawp4_.pt(),rawp4_.eta(),rawp4_.phi(),rawp4_.energy());
@@ -167,6 +175,19 @@ LeptonJetVarProducer<T>::calculatePtRatioRel(auto &lep, auto &jet, auto &vtx) co
 
   unsigned jndau = 0;
   for(const auto _d : jet->daughterPtrVector()) {
+    if (trackQuality && _d.id() == trackQuality->id() && trackQuality->filled(_d.key())) {
+      const PackedCandidateTrackQuality & q = *trackQuality;
+      unsigned int k = _d.key();
+      if(q.hasTrack(k) && q.fromPV(k)>1 && deltaR(q.eta(k),q.phi(k),lep->eta(),lep->phi())<=0.4 &&
+         q.trackPt(k)>1 &&
+         q.numberOfValidHits(k)>=8 &&
+         q.numberOfValidPixelHits(k)>=2 &&
+         q.normalizedChi2(k)<5 &&
+         fabs(q.dxy(k))<0.2 &&
+         fabs(q.dz(k))<17
+         ) jndau++;
+      continue;
+    }
     const auto d = dynamic_cast<const pat::PackedCandidate*>(_d.get());
     if (d->charge()==0) continue;
     if (d->fromPV()<=1) continue;
@@ -195,6 +216,7 @@ LeptonJetVarProducer<T>::fillDescriptions(edm::ConfigurationDescriptions& descri
   desc.add<edm::InputTag>("srcJet")->setComment("jet input collection");
   desc.add<edm::InputTag>("srcLep")->setComment("lepton input collection");
   desc.add<edm::InputTag>("srcVtx")->setComment("primary vertex input collection");
+  desc.addOptional<edm::InputTag>("trackQuality")->setComment("PackedCandidateTrackQuality of the jet constituents, computed with respect to the first vertex of srcVtx");
   std::string modname;
   if (typeid(T) == typeid(pat::Muon)) modname+="Muon";
   else if (typeid(T) == typeid(pat::Electron)) modname+="Electron";
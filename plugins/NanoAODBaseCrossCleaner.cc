@@ -68,7 +68,7 @@ NanoAODBaseCrossCleaner::~NanoAODBaseCrossCleaner()
 
 
 void
-NanoAODBaseCrossCleaner::produce(edm::Event& iEvent, const edm::EventSetup& iSetup)
+NanoAODBaseCrossCleaner::produce(edm::StreamID, edm::Event& iEvent, const edm::EventSetup& iSetup) const
 {
     using namespace edm;
     edm::Handle<edm::View<pat::Jet>> jetsIn;
@@ -103,7 +103,7 @@ NanoAODBaseCrossCleaner::produce(edm::Event& iEvent, const edm::EventSetup& iSet
     auto photonsTable = std::make_unique<FlatTable>(photonsIn->size(),photonName_,false,true);
 
 
-    objectSelection(*jetsIn,*muonsIn,*electronsIn,*tausIn,*photonsIn,jets,muons,eles,taus,photons);
+    objectSelection(iEvent,*jetsIn,*muonsIn,*electronsIn,*tausIn,*photonsIn,jets,muons,eles,taus,photons);
 
     muonsTable->addColumn<uint8_t>(name_,muons,doc_,FlatTable::UInt8Column);
     jetsTable->addColumn<uint8_t>(name_,jets,doc_,FlatTable::UInt8Column);
@@ -119,17 +119,6 @@ NanoAODBaseCrossCleaner::produce(edm::Event& iEvent, const edm::EventSetup& iSet
  
 }
 
-// ------------ method called once each stream before processing any runs, lumis or events  ------------
-void
-NanoAODBaseCrossCleaner::beginStream(edm::StreamID)
-{
-}
-
-// ------------ method called once each stream after processing all runs, lumis and events  ------------
-void
-NanoAODBaseCrossCleaner::endStream() {
-}
-
 // ------------ method fills 'descriptions' with the allowed parameters for the module  ------------
 void
 NanoAODBaseCrossCleaner::fillDescriptions(edm::ConfigurationDescriptions& descriptions) {
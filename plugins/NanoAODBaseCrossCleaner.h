@@ -25,7 +25,7 @@
 
 // user include files
 #include "FWCore/Framework/interface/Frameworkfwd.h"
-#include "FWCore/Framework/interface/stream/EDProducer.h"
+#include "FWCore/Framework/interface/global/EDProducer.h"
 
 #include "FWCore/Framework/interface/Event.h"
 #include "FWCore/Framework/interface/MakerMacros.h"
@@ -46,7 +46,7 @@
 // class declaration
 //
 
-class NanoAODBaseCrossCleaner : public edm::stream::EDProducer<> {
+class NanoAODBaseCrossCleaner : public edm::global::EDProducer<> {
    public:
       explicit NanoAODBaseCrossCleaner(const edm::ParameterSet&);
       ~NanoAODBaseCrossCleaner() override;
@@ -54,13 +54,11 @@ class NanoAODBaseCrossCleaner : public edm::stream::EDProducer<> {
       static void fillDescriptions(edm::ConfigurationDescriptions& descriptions);
 
    private:
-      void beginStream(edm::StreamID) override;
-      void produce(edm::Event&, const edm::EventSetup&) override;
-      void endStream() override;
-      virtual void objectSelection( const edm::View<pat::Jet> & jets, const edm::View<pat::Muon>  & muons, const edm::View<pat::Electron> & eles, 
+      void produce(edm::StreamID, edm::Event&, const edm::EventSetup&) const override;
+      virtual void objectSelection( const edm::Event & iEvent, const edm::View<pat::Jet> & jets, const edm::View<pat::Muon>  & muons, const edm::View<pat::Electron> & eles, 
 				    const edm::View<pat::Tau> & taus, const edm::View<pat::Photon>  & photons,
                                     std::vector<uint8_t> & jetBits, std::vector<uint8_t> & muonBits, std::vector<uint8_t> & eleBits,
-  				    std::vector<uint8_t> & tauBits, std::vector<uint8_t> & photonBits) {};
+  				    std::vector<uint8_t> & tauBits, std::vector<uint8_t> & photonBits) const {};
 
       //virtual void beginRun(edm::Run const&, edm::EventSetup const&) override;
       //virtual void endRun(edm::Run const&, edm::EventSetup const&) override;
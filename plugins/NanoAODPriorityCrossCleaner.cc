@@ -0,0 +1,197 @@
+// -*- C++ -*-
+//
+// Package:    PhysicsTools/NanoAOD
+// Class:      NanoAODPriorityCrossCleaner
+//
+/**\class NanoAODPriorityCrossCleaner NanoAODPriorityCrossCleaner.cc PhysicsTools/NanoAOD/plugins/NanoAODPriorityCrossCleaner.cc
+
+ Description: cleaning masks for any number of object collections, with priorities among the collections
+
+ Implementation:
+     Each collection has a preselection, evaluated once per object. For each mask, the collections are processed
+     by decreasing priority: an object is kept if it passes its preselection and does not overlap with a kept object
+     of a collection with higher priority. Overlaps are defined per pair of collections, by deltaR (found through
+     an eta-phi grid) and/or by shared source candidates. Collections not in the priority list of a mask just get
+     their preselection. Each collection gets an extension table with one column per mask.
+*/
+
+// system include files
+#include <memory>
+
+// user include files
+#include "FWCore/Framework/interface/Frameworkfwd.h"
+#include "FWCore/Framework/interface/global/EDProducer.h"
+
+#include "FWCore/Framework/interface/Event.h"
+#include "FWCore/Framework/interface/MakerMacros.h"
+
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/Utilities/interface/StreamID.h"
+
+#include "DataFormats/PatCandidates/interface/Muon.h"
+#include "DataFormats/PatCandidates/interface/Jet.h"
+#include "DataFormats/PatCandidates/interface/Electron.h"
+#include "DataFormats/PatCandidates/interface/Photon.h"
+#include "DataFormats/PatCandidates/interface/Tau.h"
+
+#include "DataFormats/Common/interface/View.h"
+#include "CommonTools/Utils/interface/StringCutObjectSelector.h"
+#include "PhysicsTools/NanoAOD/interface/FlatTable.h"
+#include "PhysicsTools/NanoAOD/interface/PriorityCrossCleaning.h"
+
+class NanoAODPriorityCrossCleaner : public edm::global::EDProducer<> {
+   public:
+      explicit NanoAODPriorityCrossCleaner(const edm::ParameterSet&);
+      ~NanoAODPriorityCrossCleaner() override {}
+
+      static void fillDescriptions(edm::ConfigurationDescriptions& descriptions);
+
+   private:
+      void produce(edm::StreamID, edm::Event&, const edm::EventSetup&) const override;
+
+      class Objects {
+          public:
+              Objects(const edm::ParameterSet & pset) : name(pset.getParameter<std::string>("name")), needsKeys(false), maxDeltaR(0) {}
+              virtual ~Objects() {}
+              virtual void read(const edm::Event & iEvent, crossCleaning::Objects & out) const = 0;
+              const std::string name;
+              bool needsKeys;  // some criterion uses the shared source candidates
+              float maxDeltaR; // largest deltaR of the criteria, for the grid
+      };
+      template<typename T>
+      class TypedObjects : public Objects {
+          public:
+              TypedObjects(const edm::ParameterSet & pset, edm::ConsumesCollector && cc) :
+                  Objects(pset),
+                  src_(cc.consumes<edm::View<T>>(pset.getParameter<edm::InputTag>("src"))),
+                  sel_(pset.getParameter<std::string>("sel"), true) {}
+              void read(const edm::Event & iEvent, crossCleaning::Objects & out) const override {
+                  edm::Handle<edm::View<T>> src;
+                  iEvent.getByToken(src_, src);
+                  out.kin.fill(*src);
+                  out.presel.resize(src->size());
+                  if (needsKeys) out.keys.resize(src->size());
+                  for (unsigned int i = 0, n = src->size(); i < n; ++i) {
+                      const auto & obj = (*src)[i];
+                      out.presel[i] = sel_(obj);
+                      if (needsKeys) sourceCandidateKeys(obj, out.keys[i]);
+                  }
+              }
+          private:
+              const edm::EDGetTokenT<edm::View<T>> src_;
+              const StringCutObjectSelector<T> sel_;
+      };
+
+      std::vector<std::unique_ptr<Objects>> objects_;
+      std::vector<crossCleaning::Mask> masks_;
+
+      unsigned int objectIndex(const std::string & name) const ;
+};
+
+NanoAODPriorityCrossCleaner::NanoAODPriorityCrossCleaner(const edm::ParameterSet& params)
+{
+    for (const auto & pset : params.getParameter<std::vector<edm::ParameterSet>>("objects")) {
+        const std::string & type = pset.getParameter<std::string>("type");
+        if (type == "Jet") objects_.emplace_back(new TypedObjects<pat::Jet>(pset, consumesCollector()));
+        else if (type == "Muon") objects_.emplace_back(new TypedObjects<pat::Muon>(pset, consumesCollector()));
+        else if (type == "Electron") objects_.emplace_back(new TypedObjects<pat::Electron>(pset, consumesCollector()));
+        else if (type == "Tau") objects_.emplace_back(new TypedObjects<pat::Tau>(pset, consumesCollector()));
+        else if (type == "Photon") objects_.emplace_back(new TypedObjects<pat::Photon>(pset, consumesCollector()));
+        else if (type == "Candidate") objects_.emplace_back(new TypedObjects<reco::Candidate>(pset, consumesCollector()));
+        else throw cms::Exception("Configuration", "Unsupported object type '"+type+"'\n");
+        produces<FlatTable>(objects_.back()->name);
+    }
+    for (const auto & pset : params.getParameter<std::vector<edm::ParameterSet>>("masks")) {
+        crossCleaning::Mask mask;
+        mask.name = pset.getParameter<std::string>("name");
+        mask.doc = pset.getParameter<std::string>("doc");
+        mask.criteria.resize(objects_.size());
+        std::vector<int> rank(objects_.size(), -1);
+        for (const std::string & name : pset.getParameter<std::vector<std::string>>("priority")) {
+            unsigned int i = objectIndex(name);
+            if (rank[i] != -1) throw cms::Exception("Configuration", "Collection "+name+" appears twice in the priority of "+mask.name+"\n");
+            rank[i] = mask.priority.size();
+            mask.priority.push_back(i);
+        }
+        for (const auto & cpset : pset.getParameter<std::vector<edm::ParameterSet>>("overlaps")) {
+            unsigned int a = objectIndex(cpset.getParameter<std::string>("first")), b = objectIndex(cpset.getParameter<std::string>("second"));
+            if (rank[a] == -1 || rank[b] == -1 || a == b) {
+                throw cms::Exception("Configuration", "Overlaps in "+mask.name+" must be between two different collections of its priority list\n");
+            }
+            if (rank[a] < rank[b]) std::swap(a, b); // a is the one that gets removed
+            crossCleaning::Criterion crit;
+            crit.other = b;
+            float dr = cpset.getParameter<double>("deltaR");
+            crit.deltaR2 = dr > 0 ? dr*dr : -1;
+            crit.sharedConstituents = cpset.getParameter<bool>("sharedConstituents");
+            if (crit.deltaR2 <= 0 && !crit.sharedConstituents) {
+                throw cms::Exception("Configuration", "Overlaps in "+mask.name+" need a deltaR or sharedConstituents\n");
+            }
+            if (crit.sharedConstituents) objects_[a]->needsKeys = objects_[b]->needsKeys = true;
+            if (dr > 0) objects_[b]->maxDeltaR = std::max(objects_[b]->maxDeltaR, dr);
+            mask.criteria[a].push_back(crit);
+        }
+        masks_.push_back(mask);
+    }
+}
+
+unsigned int
+NanoAODPriorityCrossCleaner::objectIndex(const std::string & name) const
+{
+    for (unsigned int i = 0, n = objects_.size(); i < n; ++i) {
+        if (objects_[i]->name == name) return i;
+    }
+    throw cms::Exception("Configuration", "Unknown collection "+name+"\n");
+}
+
+void
+NanoAODPriorityCrossCleaner::produce(edm::StreamID, edm::Event& iEvent, const edm::EventSetup& iSetup) const
+{
+    unsigned int nobjs = objects_.size();
+    std::vector<crossCleaning::Objects> objs(nobjs);
+    std::vector<std::unique_ptr<matching::EtaPhiGrid>> grids(nobjs);
+    for (unsigned int i = 0; i < nobjs; ++i) {
+        objects_[i]->read(iEvent, objs[i]);
+        if (objects_[i]->maxDeltaR > 0) {
+            grids[i].reset(new matching::EtaPhiGrid(objs[i].kin.eta().data(), objs[i].kin.phi().data(), objs[i].kin.size(), objects_[i]->maxDeltaR));
+        }
+    }
+
+    std::vector<std::unique_ptr<FlatTable>> tables(nobjs);
+    for (unsigned int i = 0; i < nobjs; ++i) tables[i].reset(new FlatTable(objs[i].presel.size(), objects_[i]->name, false, true));
+
+    std::vector<std::vector<uint8_t>> kept;
+    for (const crossCleaning::Mask & mask : masks_) {
+        crossCleaning::computeMask(mask, objs, grids, kept);
+        for (unsigned int i = 0; i < nobjs; ++i) tables[i]->addColumn<uint8_t>(mask.name, kept[i], mask.doc, FlatTable::UInt8Column);
+    }
+
+    for (unsigned int i = 0; i < nobjs; ++i) iEvent.put(std::move(tables[i]), objects_[i]->name);
+}
+
+// ------------ method fills 'descriptions' with the allowed parameters for the module  ------------
+void
+NanoAODPriorityCrossCleaner::fillDescriptions(edm::ConfigurationDescriptions& descriptions) {
+  edm::ParameterSetDescription desc;
+  edm::ParameterSetDescription objects;
+  objects.add<std::string>("name")->setComment("name of the table to extend with the masks, also used to refer to the collection below");
+  objects.add<std::string>("type")->setComment("type of the objects: Jet, Muon, Electron, Tau, Photon or Candidate");
+  objects.add<edm::InputTag>("src")->setComment("objects of the table");
+  objects.add<std::string>("sel")->setComment("preselection, applied in all the masks");
+  desc.addVPSet("objects", objects)->setComment("collections to clean");
+  edm::ParameterSetDescription overlaps;
+  overlaps.add<std::string>("first")->setComment("one of the two collections");
+  overlaps.add<std::string>("second")->setComment("the other collection (the one with lower priority loses the overlapping objects)");
+  overlaps.add<double>("deltaR", -1.)->setComment("objects closer than deltaR overlap (not used if <= 0)");
+  overlaps.add<bool>("sharedConstituents", false)->setComment("objects sharing a source candidate overlap");
+  edm::ParameterSetDescription masks;
+  masks.add<std::string>("name")->setComment("name of the mask column");
+  masks.add<std::string>("doc")->setComment("documentation of the mask column");
+  masks.add<std::vector<std::string>>("priority")->setComment("collections by decreasing priority");
+  masks.addVPSet("overlaps", overlaps)->setComment("overlap criteria between pairs of collections of the priority list");
+  desc.addVPSet("masks", masks)->setComment("cleaning masks, one column each in the table of every collection");
+  descriptions.add("priorityCleanerTable", desc);
+}
+
+//define this as a plug-in
+DEFINE_FWK_MODULE(NanoAODPriorityCrossCleaner);
@@ -1,26 +1,44 @@
 #include "PhysicsTools/NanoAOD/plugins/NanoAODBaseCrossCleaner.h"
+#include "PhysicsTools/NanoAOD/interface/FlatTable.h"
 
+/// The overlaps between jets and leptons are read from the link tables of PATObjectCrossLinker for muons and electrons
+/// (muonLinks and electronLinks, with the index of the jet of each lepton in the column jetIdx), made from the same collections.
 class NanoAODSimpleCrossCleaner : public NanoAODBaseCrossCleaner {
 public:
-      NanoAODSimpleCrossCleaner(const edm::ParameterSet&p):NanoAODBaseCrossCleaner(p){}
+      NanoAODSimpleCrossCleaner(const edm::ParameterSet&p):NanoAODBaseCrossCleaner(p),
+          muonLinks_(consumes<FlatTable>(p.getParameter<edm::InputTag>("muonLinks"))),
+          electronLinks_(consumes<FlatTable>(p.getParameter<edm::InputTag>("electronLinks"))) {}
       ~NanoAODSimpleCrossCleaner() override{}
 
-      void objectSelection( const edm::View<pat::Jet> & jets, const edm::View<pat::Muon>  & muons, const edm::View<pat::Electron> & eles,
+      void objectSelection( const edm::Event & iEvent, const edm::View<pat::Jet> & jets, const edm::View<pat::Muon>  & muons, const edm::View<pat::Electron> & eles,
                                     const edm::View<pat::Tau> & taus, const edm::View<pat::Photon>  & photons,
                                     std::vector<uint8_t> & jetBits, std::vector<uint8_t> & muonBits, std::vector<uint8_t> & eleBits,
-                                    std::vector<uint8_t> & tauBits, std::vector<uint8_t> & photonBits) override     {
+                                    std::vector<uint8_t> & tauBits, std::vector<uint8_t> & photonBits) const override     {
 
- 	    for(size_t i=0;i<jets.size();i++){
-		for(const auto & m : jets[i].overlaps("muons")) {
-			if(muonBits[m.key()]) jetBits[i]=0; //prefer muons
-		}
-                for(const auto & m : jets[i].overlaps("electrons")) {
-                        if(eleBits[m.key()]) jetBits[i]=0; //prefer electrons
-                }
+            edm::Handle<FlatTable> muonLinks, electronLinks;
+            iEvent.getByToken(muonLinks_, muonLinks);
+            iEvent.getByToken(electronLinks_, electronLinks);
+            auto muonJet = jetIndices(*muonLinks, muons.size());
+            auto eleJet = jetIndices(*electronLinks, eles.size());
 
+            for(size_t i=0;i<muons.size();i++){
+                if(muonBits[i] && muonJet[i] >= 0) jetBits[muonJet[i]]=0; //prefer muons
+            }
+            for(size_t i=0;i<eles.size();i++){
+                if(eleBits[i] && eleJet[i] >= 0) jetBits[eleJet[i]]=0; //prefer electrons
             }
 	}
- 
+
+private:
+      static boost::sub_range<const std::vector<int>> jetIndices(const FlatTable & links, unsigned int size) {
+            int col = links.columnIndex("jetIdx");
+            if (col == -1 || links.size() != size) throw cms::Exception("Configuration", "The link table "+links.name()+" must have a column jetIdx and one row per object\n");
+            return links.columnData<int>(col);
+      }
+
+      const edm::EDGetTokenT<FlatTable> muonLinks_;
+      const edm::EDGetTokenT<FlatTable> electronLinks_;
+
 };
 DEFINE_FWK_MODULE(NanoAODSimpleCrossCleaner);
 
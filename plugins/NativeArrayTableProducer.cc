@@ -1,11 +1,11 @@
-#include "FWCore/Framework/interface/stream/EDProducer.h"
+#include "FWCore/Framework/interface/global/EDProducer.h"
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
 #include "PhysicsTools/NanoAOD/interface/FlatTable.h"
 
 #include <vector>
 
 template<typename TIn, typename TCol, FlatTable::ColumnType CT>
-class NativeArrayTableProducer : public edm::stream::EDProducer<> {
+class NativeArrayTableProducer : public edm::global::EDProducer<> {
     public:
 
         NativeArrayTableProducer( edm::ParameterSet const & params ) :
@@ -18,7 +18,7 @@ class NativeArrayTableProducer : public edm::stream::EDProducer<> {
 
         ~NativeArrayTableProducer() override {}
 
-        void produce(edm::Event& iEvent, const edm::EventSetup& iSetup) override {
+        void produce(edm::StreamID, edm::Event& iEvent, const edm::EventSetup& iSetup) const override {
             edm::Handle<TIn> src;
             iEvent.getByToken(src_, src);
 
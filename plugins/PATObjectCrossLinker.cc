@@ -5,10 +5,13 @@
 // 
 /**\class PATObjectCrossLinker PATObjectCrossLinker.cc PhysicsTools/PATObjectCrossLinker/plugins/PATObjectCrossLinker.cc
 
- Description: [one line class summary]
+ Description: links jets, leptons and photons that share PF candidates (or the supercluster, for electrons and photons)
 
  Implementation:
-     [Notes on implementation]
+     By default, copies the collections and stores the links as overlaps and userCands of the copies.
+     With linkTables = True, the links are also stored as index columns of extension FlatTables (one per
+     collection, with the names given by jetName, muonName, ...), with indices referring to the input collections;
+     with copyCollections = False, only the tables are produced and nothing is copied.
 */
 //
 // Original Author:  Andrea Rizzi
@@ -22,12 +25,15 @@
 
 // user include files
 #include "FWCore/Framework/interface/Frameworkfwd.h"
-#include "FWCore/Framework/interface/stream/EDProducer.h"
+#include "FWCore/Framework/interface/global/EDProducer.h"
 
 #include "FWCore/Framework/interface/Event.h"
 #include "FWCore/Framework/interface/MakerMacros.h"
 
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/ParameterSet/interface/ConfigurationDescriptions.h"
+#include "FWCore/ParameterSet/interface/ParameterSetDescription.h"
+#include "FWCore/ParameterSet/interface/EmptyGroupDescription.h"
 #include "FWCore/Utilities/interface/StreamID.h"
 
 #include "DataFormats/PatCandidates/interface/Muon.h"
@@ -39,11 +45,12 @@
 #include "DataFormats/Common/interface/View.h"
 
 #include "PhysicsTools/NanoAOD/interface/MatchingUtils.h"
+#include "PhysicsTools/NanoAOD/interface/FlatTable.h"
 //
 // class declaration
 //
 
-class PATObjectCrossLinker : public edm::stream::EDProducer<> {
+class PATObjectCrossLinker : public edm::global::EDProducer<> {
    public:
       explicit PATObjectCrossLinker(const edm::ParameterSet&);
       ~PATObjectCrossLinker() override;
@@ -51,15 +58,25 @@ class PATObjectCrossLinker : public edm::stream::EDProducer<> {
       static void fillDescriptions(edm::ConfigurationDescriptions& descriptions);
 
    private:
-      void beginStream(edm::StreamID) override;
-      void produce(edm::Event&, const edm::EventSetup&) override;
-      void endStream() override;
-
-      void matchOneToMany(const auto & refProdOne, auto & itemsOne, const std::string & nameOne,
-                    const auto & refProdMany, auto& itemsMany, const std::string & nameMany);
-
-      void matchElectronToPhoton(const auto & refProdOne, auto & itemsOne, const std::string & nameOne,
-                    const auto & refProdMany, auto& itemsMany, const std::string & nameMany);
+      void produce(edm::StreamID, edm::Event&, const edm::EventSetup&) const override;
+
+      /// links from each object of a collection to the objects of another
+      struct Links {
+          std::vector<std::vector<unsigned int>> overlaps; // for each object of the first collection, the matched ones of the second
+          std::vector<int> owner; // for each object of the second collection, the one of the first it's linked to (or -1)
+      };
+      /// each object of itemsMany is linked to the first object of itemsOne that shares a key with it (keysOf fills the keys of an object)
+      template<typename C1, typename C2, typename KeysOf>
+      Links matchOneToMany(const C1 & itemsOne, const C2 & itemsMany, KeysOf keysOf) const;
+
+      /// store the links as overlaps (in itemsOne, with name nameMany) and userCands (in itemsMany, with name nameOne)
+      void applyLinks(const Links & links, const auto & refProdOne, auto & itemsOne, const std::string & nameOne,
+                    const auto & refProdMany, auto& itemsMany, const std::string & nameMany) const;
+
+      /// columns with the number of linked objects and the indices of the first two
+      static void addOverlapColumns(FlatTable & table, const Links & links, const std::string & name, const std::string & nName) ;
+      /// column with the index of the linked object
+      static void addOwnerColumn(FlatTable & table, const Links & links, const std::string & name, const std::string & doc) ;
 
       //virtual void beginRun(edm::Run const&, edm::EventSetup const&) override;
       //virtual void endRun(edm::Run const&, edm::EventSetup const&) override;
@@ -73,6 +90,9 @@ class PATObjectCrossLinker : public edm::stream::EDProducer<> {
       const edm::EDGetTokenT<edm::View<pat::Tau>> taus_;
       const edm::EDGetTokenT<edm::View<pat::Photon>> photons_;
 
+      const bool linkTables_, copyCollections_;
+      std::string jetName_, muonName_, electronName_, tauName_, photonName_;
+
 
 };
 
@@ -84,14 +104,28 @@ PATObjectCrossLinker::PATObjectCrossLinker(const edm::ParameterSet& params):
     muons_(consumes<edm::View<pat::Muon>>( params.getParameter<edm::InputTag>("muons") )),
     electrons_(consumes<edm::View<pat::Electron>>( params.getParameter<edm::InputTag>("electrons") )),
     taus_(consumes<edm::View<pat::Tau>>( params.getParameter<edm::InputTag>("taus") )),
-    photons_(consumes<edm::View<pat::Photon>>( params.getParameter<edm::InputTag>("photons") ))
+    photons_(consumes<edm::View<pat::Photon>>( params.getParameter<edm::InputTag>("photons") )),
+    linkTables_(params.existsAs<bool>("linkTables") ? params.getParameter<bool>("linkTables") : false),
+    copyCollections_(params.existsAs<bool>("copyCollections") ? params.getParameter<bool>("copyCollections") : true)
 
 {
-   produces<std::vector<pat::Jet>>("jets");
-   produces<std::vector<pat::Muon>>("muons");
-   produces<std::vector<pat::Electron>>("electrons");
-   produces<std::vector<pat::Tau>>("taus");
-   produces<std::vector<pat::Photon>>("photons");
+   if (linkTables_) {
+      jetName_ = params.getParameter<std::string>("jetName");
+      muonName_ = params.getParameter<std::string>("muonName");
+      electronName_ = params.getParameter<std::string>("electronName");
+      tauName_ = params.getParameter<std::string>("tauName");
+      photonName_ = params.getParameter<std::string>("photonName");
+      for (const char * label : { "jets", "muons", "electrons", "taus", "photons" }) produces<FlatTable>(label);
+   } else if (!copyCollections_) {
+      throw cms::Exception("Configuration", "PATObjectCrossLinker with neither linkTables nor copyCollections\n");
+   }
+   if (copyCollections_) {
+      produces<std::vector<pat::Jet>>("jets");
+      produces<std::vector<pat::Muon>>("muons");
+      produces<std::vector<pat::Electron>>("electrons");
+      produces<std::vector<pat::Tau>>("taus");
+      produces<std::vector<pat::Photon>>("photons");
+   }
   
 }
 
@@ -111,86 +145,123 @@ PATObjectCrossLinker::~PATObjectCrossLinker()
 
 // ------------ method called to produce the data  ------------
 
-///
-void PATObjectCrossLinker::matchOneToMany(const auto & refProdOne, auto & itemsOne, const std::string & nameOne,
-		    const auto & refProdMany, auto& itemsMany, const std::string & nameMany)
+template<typename C1, typename C2, typename KeysOf>
+PATObjectCrossLinker::Links PATObjectCrossLinker::matchOneToMany(const C1 & itemsOne, const C2 & itemsMany, KeysOf keysOf) const
 {
-    size_t ji=0;
-    for(auto & j: itemsOne) {
-        edm::PtrVector<reco::Candidate> overlaps(refProdMany.id());
-        size_t mi=0;
-        for(auto & m: itemsMany){
-	    if(matchByCommonSourceCandidatePtr(j,m) && (!m.hasUserCand(nameOne))){
-                m.addUserCand(nameOne,reco::CandidatePtr(refProdOne.id(), ji, refProdOne.productGetter()));
-                overlaps.push_back(reco::CandidatePtr(refProdMany.id(), mi, refProdMany.productGetter()));
-            }
-            mi++;
+    Links links;
+    links.overlaps.resize(itemsOne.size());
+    links.owner.resize(itemsMany.size(), -1);
+    MatchingKeyIndex index(itemsOne, keysOf);
+    for (unsigned int mi = 0, nm = itemsMany.size(); mi < nm; ++mi) {
+        int ji = index.firstMatch(itemsMany[mi], keysOf);
+        if (ji >= 0) {
+            links.owner[mi] = ji;
+            links.overlaps[ji].push_back(mi);
         }
-    j.setOverlaps(nameMany,overlaps);
-    ji++;
-   } 
+    }
+    return links;
 }
 
-void PATObjectCrossLinker::matchElectronToPhoton(const auto & refProdOne, auto & itemsOne, const std::string & nameOne,
-		    const auto & refProdMany, auto& itemsMany, const std::string & nameMany)
+void PATObjectCrossLinker::applyLinks(const Links & links, const auto & refProdOne, auto & itemsOne, const std::string & nameOne,
+		    const auto & refProdMany, auto& itemsMany, const std::string & nameMany) const
 {
-    size_t ji=0;
-    for(auto & j: itemsOne) {
+    for (unsigned int ji = 0, nj = itemsOne.size(); ji < nj; ++ji) {
         edm::PtrVector<reco::Candidate> overlaps(refProdMany.id());
-        size_t mi=0;
-        for(auto & m: itemsMany){
-	    if(matchByCommonParentSuperClusterRef(j,m) && (!m.hasUserCand(nameOne))){
-                m.addUserCand(nameOne,reco::CandidatePtr(refProdOne.id(), ji, refProdOne.productGetter()));
-                overlaps.push_back(reco::CandidatePtr(refProdMany.id(), mi, refProdMany.productGetter()));
-            }
-            mi++;
+        for (unsigned int mi : links.overlaps[ji]) {
+            itemsMany[mi].addUserCand(nameOne,reco::CandidatePtr(refProdOne.id(), ji, refProdOne.productGetter()));
+            overlaps.push_back(reco::CandidatePtr(refProdMany.id(), mi, refProdMany.productGetter()));
         }
-    j.setOverlaps(nameMany,overlaps);
-    ji++;
-   } 
+        itemsOne[ji].setOverlaps(nameMany,overlaps);
+    }
 }
 
+void PATObjectCrossLinker::addOverlapColumns(FlatTable & table, const Links & links, const std::string & name, const std::string & nName)
+{
+    unsigned int n = links.overlaps.size();
+    std::vector<int> count(n), idx1(n, -1), idx2(n, -1);
+    for (unsigned int i = 0; i < n; ++i) {
+        const auto & overlaps = links.overlaps[i];
+        count[i] = overlaps.size();
+        if (overlaps.size() > 0) idx1[i] = overlaps[0];
+        if (overlaps.size() > 1) idx2[i] = overlaps[1];
+    }
+    table.addColumn<int>(nName, count, "number of "+name+"s in the jet", FlatTable::IntColumn);
+    table.addColumn<int>(name+"Idx1", idx1, "index of first matching "+name, FlatTable::IntColumn);
+    table.addColumn<int>(name+"Idx2", idx2, "index of second matching "+name, FlatTable::IntColumn);
+}
+
+void PATObjectCrossLinker::addOwnerColumn(FlatTable & table, const Links & links, const std::string & name, const std::string & doc)
+{
+    table.addColumn<int>(name+"Idx", links.owner, doc, FlatTable::IntColumn);
+}
 
 void
-PATObjectCrossLinker::produce(edm::Event& iEvent, const edm::EventSetup& iSetup)
+PATObjectCrossLinker::produce(edm::StreamID, edm::Event& iEvent, const edm::EventSetup& iSetup) const
 {
     using namespace edm;
     edm::Handle<edm::View<pat::Jet>> jetsIn;
     iEvent.getByToken(jets_, jetsIn);
-    auto jets = std::make_unique<std::vector<pat::Jet>>();
-    for(const auto & j  : *jetsIn) jets->push_back(j);
-    auto jetRefProd =  iEvent.getRefBeforePut< std::vector<pat::Jet> >("jets");
-
     edm::Handle<edm::View<pat::Muon>> muonsIn;
     iEvent.getByToken(muons_, muonsIn);
-    auto muons = std::make_unique<std::vector<pat::Muon>>();
-    for(const auto & m  : *muonsIn) muons->push_back(m);
-    auto muRefProd =  iEvent.getRefBeforePut< std::vector<pat::Muon> >("muons");
-
     edm::Handle<edm::View<pat::Electron>> electronsIn;
     iEvent.getByToken(electrons_, electronsIn);
-    auto electrons = std::make_unique<std::vector<pat::Electron>>();
-    for(const auto & e  : *electronsIn) electrons->push_back(e);
-    auto eleRefProd =  iEvent.getRefBeforePut< std::vector<pat::Electron> >("electrons");
-
     edm::Handle<edm::View<pat::Tau>> tausIn;
     iEvent.getByToken(taus_, tausIn);
-    auto taus = std::make_unique<std::vector<pat::Tau>>();
-    for(const auto & t  : *tausIn) taus->push_back(t);
-    auto tauRefProd =  iEvent.getRefBeforePut< std::vector<pat::Tau> >("taus");
-
     edm::Handle<edm::View<pat::Photon>> photonsIn;
     iEvent.getByToken(photons_, photonsIn);
-    auto photons = std::make_unique<std::vector<pat::Photon>>();
-    for(const auto & p  : *photonsIn) photons->push_back(p);
+
+    auto bySource = [](const auto & c, std::vector<uint64_t> & keys) { sourceCandidateKeys(c, keys); };
+    auto bySuperCluster = [](const auto & c, std::vector<uint64_t> & keys) { parentSuperClusterKeys(c, keys); };
+    Links jetMu = matchOneToMany(*jetsIn, *muonsIn, bySource);
+    Links jetEle = matchOneToMany(*jetsIn, *electronsIn, bySource);
+    Links jetTau = matchOneToMany(*jetsIn, *tausIn, bySource);
+    Links jetPho = matchOneToMany(*jetsIn, *photonsIn, bySource);
+    Links elePho = matchOneToMany(*electronsIn, *photonsIn, bySuperCluster);
+
+    if (linkTables_) {
+        auto jetTab = std::make_unique<FlatTable>(jetsIn->size(), jetName_, false, true);
+        addOverlapColumns(*jetTab, jetMu, "muon", "nMuons");
+        addOverlapColumns(*jetTab, jetEle, "electron", "nElectrons");
+        auto muTab = std::make_unique<FlatTable>(muonsIn->size(), muonName_, false, true);
+        addOwnerColumn(*muTab, jetMu, "jet", "index of the associated jet (-1 if none)");
+        auto eleTab = std::make_unique<FlatTable>(electronsIn->size(), electronName_, false, true);
+        addOwnerColumn(*eleTab, jetEle, "jet", "index of the associated jet (-1 if none)");
+        std::vector<int> photonIdx(electronsIn->size(), -1);
+        for (unsigned int i = 0, n = photonIdx.size(); i < n; ++i) {
+            if (!elePho.overlaps[i].empty()) photonIdx[i] = elePho.overlaps[i].front();
+        }
+        eleTab->addColumn<int>("photonIdx", photonIdx, "index of the associated photon (-1 if none)", FlatTable::IntColumn);
+        auto tauTab = std::make_unique<FlatTable>(tausIn->size(), tauName_, false, true);
+        addOwnerColumn(*tauTab, jetTau, "jet", "index of the associated jet (-1 if none)");
+        auto phoTab = std::make_unique<FlatTable>(photonsIn->size(), photonName_, false, true);
+        addOwnerColumn(*phoTab, jetPho, "jet", "index of the associated jet (-1 if none)");
+        addOwnerColumn(*phoTab, elePho, "electron", "index of the associated electron (-1 if none)");
+
+        iEvent.put(std::move(jetTab),"jets");
+        iEvent.put(std::move(muTab),"muons");
+        iEvent.put(std::move(eleTab),"electrons");
+        iEvent.put(std::move(tauTab),"taus");
+        iEvent.put(std::move(phoTab),"photons");
+    }
+    if (!copyCollections_) return;
+
+    auto jets = std::make_unique<std::vector<pat::Jet>>(jetsIn->begin(), jetsIn->end());
+    auto jetRefProd =  iEvent.getRefBeforePut< std::vector<pat::Jet> >("jets");
+    auto muons = std::make_unique<std::vector<pat::Muon>>(muonsIn->begin(), muonsIn->end());
+    auto muRefProd =  iEvent.getRefBeforePut< std::vector<pat::Muon> >("muons");
+    auto electrons = std::make_unique<std::vector<pat::Electron>>(electronsIn->begin(), electronsIn->end());
+    auto eleRefProd =  iEvent.getRefBeforePut< std::vector<pat::Electron> >("electrons");
+    auto taus = std::make_unique<std::vector<pat::Tau>>(tausIn->begin(), tausIn->end());
+    auto tauRefProd =  iEvent.getRefBeforePut< std::vector<pat::Tau> >("taus");
+    auto photons = std::make_unique<std::vector<pat::Photon>>(photonsIn->begin(), photonsIn->end());
     auto phRefProd =  iEvent.getRefBeforePut< std::vector<pat::Photon> >("photons");
 
-    matchOneToMany(jetRefProd,*jets,"jet",muRefProd,*muons,"muons");
-    matchOneToMany(jetRefProd,*jets,"jet",eleRefProd,*electrons,"electrons");
-    matchOneToMany(jetRefProd,*jets,"jet",tauRefProd,*taus,"taus");
-    matchOneToMany(jetRefProd,*jets,"jet",phRefProd,*photons,"photons");
+    applyLinks(jetMu,jetRefProd,*jets,"jet",muRefProd,*muons,"muons");
+    applyLinks(jetEle,jetRefProd,*jets,"jet",eleRefProd,*electrons,"electrons");
+    applyLinks(jetTau,jetRefProd,*jets,"jet",tauRefProd,*taus,"taus");
+    applyLinks(jetPho,jetRefProd,*jets,"jet",phRefProd,*photons,"photons");
 
-    matchElectronToPhoton(eleRefProd,*electrons,"electron",phRefProd,*photons,"photons");
+    applyLinks(elePho,eleRefProd,*electrons,"electron",phRefProd,*photons,"photons");
 
     iEvent.put(std::move(jets),"jets");
     iEvent.put(std::move(muons),"muons");
@@ -200,25 +271,26 @@ PATObjectCrossLinker::produce(edm::Event& iEvent, const edm::EventSetup& iSetup)
  
 }
 
-// ------------ method called once each stream before processing any runs, lumis or events  ------------
-void
-PATObjectCrossLinker::beginStream(edm::StreamID)
-{
-}
-
-// ------------ method called once each stream after processing all runs, lumis and events  ------------
-void
-PATObjectCrossLinker::endStream() {
-}
-
 // ------------ method fills 'descriptions' with the allowed parameters for the module  ------------
 void
 PATObjectCrossLinker::fillDescriptions(edm::ConfigurationDescriptions& descriptions) {
-  //The following says we do not know what parameters are allowed so do no validation
-  // Please change this to state exactly what you do use, even if it is no parameters
   edm::ParameterSetDescription desc;
-  desc.setUnknown();
-  descriptions.addDefault(desc);
+  desc.add<edm::InputTag>("jets")->setComment("input jets");
+  desc.add<edm::InputTag>("muons")->setComment("input muons");
+  desc.add<edm::InputTag>("electrons")->setComment("input electrons");
+  desc.add<edm::InputTag>("taus")->setComment("input taus");
+  desc.add<edm::InputTag>("photons")->setComment("input photons");
+  desc.add<bool>("copyCollections", true)->setComment("copy the collections, with the links as overlaps and userCands of the copies");
+  desc.ifValue(edm::ParameterDescription<bool>("linkTables", false, true),
+               false >> edm::EmptyGroupDescription() or
+               true >> (edm::ParameterDescription<std::string>("jetName", true) and
+                        edm::ParameterDescription<std::string>("muonName", true) and
+                        edm::ParameterDescription<std::string>("electronName", true) and
+                        edm::ParameterDescription<std::string>("tauName", true) and
+                        edm::ParameterDescription<std::string>("photonName", true)))->setComment(
+               "store the links as index columns of extension tables, with the names given by jetName, muonName, ...; "
+               "the indices refer to the input collections");
+  descriptions.add("linkedObjects", desc);
 }
 
 //define this as a plug-in
@@ -1,4 +1,4 @@
-#include "FWCore/Framework/interface/stream/EDProducer.h"
+#include "FWCore/Framework/interface/global/EDProducer.h"
 #include "FWCore/Framework/interface/Event.h"
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
 #include "FWCore/Utilities/interface/InputTag.h"
@@ -53,7 +53,7 @@ namespace pat {
   } // namespace helper
 
   template<typename T>
-  class PATObjectUserDataEmbedder : public edm::stream::EDProducer<> {
+  class PATObjectUserDataEmbedder : public edm::global::EDProducer<> {
 
     public:
 
@@ -69,7 +69,7 @@ namespace pat {
 
       ~PATObjectUserDataEmbedder() override {}
 
-      void produce(edm::Event & iEvent, const edm::EventSetup& iSetup) override;
+      void produce(edm::StreamID, edm::Event & iEvent, const edm::EventSetup& iSetup) const override;
 
       static void fillDescriptions(edm::ConfigurationDescriptions & descriptions) {
           edm::ParameterSetDescription desc;
@@ -98,7 +98,7 @@ namespace pat {
 }
 
 template<typename T>
-void pat::PATObjectUserDataEmbedder<T>::produce(edm::Event & iEvent, const edm::EventSetup& iSetup) {
+void pat::PATObjectUserDataEmbedder<T>::produce(edm::StreamID, edm::Event & iEvent, const edm::EventSetup& iSetup) const {
     edm::Handle<edm::View<T>> src;
     iEvent.getByToken(src_, src);
 
@@ -0,0 +1,229 @@
+// -*- C++ -*-
+//
+// Package:    PhysicsTools/NanoAOD
+// Class:      PFIsolationProducer
+//
+/**\class PFIsolationProducer PFIsolationProducer.cc PhysicsTools/NanoAOD/plugins/PFIsolationProducer.cc
+
+ Description: PF isolation of leptons in any number of fixed or pt-dependent (mini-isolation) cones, from the packed PF candidates
+
+ Implementation:
+     The PF candidates are sorted once per event into an eta-phi grid (MatchingUtils.h). For each lepton, the candidates
+     within the largest of its cones are visited once, and added to the sums of all the isolations they belong to
+     (LeptonPFIsolation.h). As in pat::getMiniPFIsolation, charged hadrons (|pdgId| 211) with fromPV() > 1 go in the
+     charged sum and the other ones in the pileup sum, neutral hadrons (130) and photons (22) in their own sums. Each
+     isolation has its own cone, veto cones and pt threshold for neutrals, photons and pileup, can veto the source
+     candidates of the lepton, and subtracts the pileup with deltaBeta, effective areas (scaled with the cone area) or not at all.
+     For each isolation <name>, ValueMaps <name>Chg, <name>Neu, <name>Pho, <name>PU and <name>All are produced, with
+     All = Chg + max(0, Neu + Pho - pileup correction).
+*/
+
+#include <memory>
+
+#include "FWCore/Framework/interface/Frameworkfwd.h"
+#include "FWCore/Framework/interface/global/EDProducer.h"
+
+#include "FWCore/Framework/interface/Event.h"
+#include "FWCore/Framework/interface/MakerMacros.h"
+
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/ParameterSet/interface/FileInPath.h"
+#include "FWCore/Utilities/interface/StreamID.h"
+
+#include "RecoEgamma/EgammaTools/interface/EffectiveAreas.h"
+
+#include "DataFormats/PatCandidates/interface/Muon.h"
+#include "DataFormats/PatCandidates/interface/Electron.h"
+#include "DataFormats/PatCandidates/interface/PackedCandidate.h"
+#include "DataFormats/Common/interface/ValueMap.h"
+
+#include "PhysicsTools/NanoAOD/interface/LeptonPFIsolation.h"
+
+template <typename T>
+class PFIsolationProducer : public edm::global::EDProducer<> {
+    public:
+        explicit PFIsolationProducer(const edm::ParameterSet &iConfig) ;
+        ~PFIsolationProducer() override {}
+
+        static void fillDescriptions(edm::ConfigurationDescriptions& descriptions);
+
+    private:
+        void produce(edm::StreamID, edm::Event&, const edm::EventSetup&) const override;
+
+        float getEtaForEA(const T &) const ;
+
+        const edm::EDGetTokenT<edm::View<T>> src_;
+        const edm::EDGetTokenT<edm::View<pat::PackedCandidate>> pfCands_;
+        edm::EDGetTokenT<double> rho_;
+        std::unique_ptr<EffectiveAreas> ea_;
+        std::vector<pfIsolation::Isolation> isolations_;
+        float maxCone_;
+        bool needsKeys_;
+};
+
+template <typename T>
+PFIsolationProducer<T>::PFIsolationProducer(const edm::ParameterSet &iConfig) :
+    src_(consumes<edm::View<T>>(iConfig.getParameter<edm::InputTag>("src"))),
+    pfCands_(consumes<edm::View<pat::PackedCandidate>>(iConfig.getParameter<edm::InputTag>("pfCands"))),
+    maxCone_(0), needsKeys_(false)
+{
+    bool needsEA = false;
+    for (const auto & pset : iConfig.getParameter<std::vector<edm::ParameterSet>>("isolations")) {
+        pfIsolation::Isolation iso;
+        iso.name = pset.getParameter<std::string>("name");
+        const std::string & cone = pset.getParameter<std::string>("cone");
+        if (cone == "fixed") {
+            iso.mini = false;
+            iso.dR = pset.getParameter<double>("dR");
+            iso.ktScale = iso.dRMin = 0; iso.dRMax = iso.dR;
+        } else if (cone == "mini") {
+            iso.mini = true;
+            iso.dR = 0;
+            iso.ktScale = pset.getParameter<double>("ktScale");
+            iso.dRMin = pset.getParameter<double>("dRMin");
+            iso.dRMax = pset.getParameter<double>("dRMax");
+        } else {
+            throw cms::Exception("Configuration", "Unknown cone type '"+cone+"' for isolation "+iso.name+" (must be fixed or mini)\n");
+        }
+        iso.setVeto(pfIsolation::Charged, pset.getParameter<double>("chargedVeto"));
+        iso.setVeto(pfIsolation::PileUp, pset.getParameter<double>("puVeto"));
+        iso.setVeto(pfIsolation::Neutral, pset.getParameter<double>("neutralVeto"));
+        iso.setVeto(pfIsolation::Photon, pset.getParameter<double>("photonVeto"));
+        iso.ptThreshold = pset.getParameter<double>("ptThreshold");
+        iso.vetoSourceCandidates = pset.getParameter<bool>("vetoSourceCandidates");
+        const std::string & pu = pset.getParameter<std::string>("puCorrection");
+        iso.deltaBetaFactor = 0;
+        if (pu == "none") iso.puCorrection = pfIsolation::NoCorrection;
+        else if (pu == "deltaBeta") { iso.puCorrection = pfIsolation::DeltaBeta; iso.deltaBetaFactor = pset.getParameter<double>("deltaBetaFactor"); }
+        else if (pu == "effectiveArea") { iso.puCorrection = pfIsolation::EffectiveArea; needsEA = true; }
+        else throw cms::Exception("Configuration", "Unknown puCorrection '"+pu+"' for isolation "+iso.name+" (must be none, deltaBeta or effectiveArea)\n");
+        maxCone_ = std::max(maxCone_, iso.dRMax);
+        needsKeys_ = needsKeys_ || iso.vetoSourceCandidates;
+        isolations_.push_back(iso);
+        for (const char * what : { "Chg", "Neu", "Pho", "PU", "All" }) produces<edm::ValueMap<float>>(iso.name + what);
+    }
+    if (needsEA) {
+        ea_.reset(new EffectiveAreas(iConfig.getParameter<edm::FileInPath>("EAFile").fullPath()));
+        rho_ = consumes<double>(iConfig.getParameter<edm::InputTag>("rho"));
+    }
+}
+
+template<typename T> float PFIsolationProducer<T>::getEtaForEA(const T & obj) const {
+    return obj.eta();
+}
+template<> float PFIsolationProducer<pat::Electron>::getEtaForEA(const pat::Electron & el) const {
+    return el.superCluster()->eta();
+}
+
+template <typename T>
+void
+PFIsolationProducer<T>::produce(edm::StreamID, edm::Event& iEvent, const edm::EventSetup& iSetup) const
+{
+    edm::Handle<edm::View<T>> src;
+    iEvent.getByToken(src_, src);
+    edm::Handle<edm::View<pat::PackedCandidate>> pfCands;
+    iEvent.getByToken(pfCands_, pfCands);
+    double rho = 0;
+    if (ea_) {
+        edm::Handle<double> rhoH;
+        iEvent.getByToken(rho_, rhoH);
+        rho = *rhoH;
+    }
+
+    unsigned int nlep = src->size(), niso = isolations_.size();
+    // only the candidates that can be in some cone go in the grid
+    float etaMin = 0, etaMax = 0;
+    for (unsigned int i = 0; i < nlep; ++i) {
+        float eta = (*src)[i].eta();
+        if (i == 0 || eta < etaMin) etaMin = eta;
+        if (i == 0 || eta > etaMax) etaMax = eta;
+    }
+    pfIsolation::Candidates cands;
+    if (nlep) {
+        for (unsigned int j = 0, n = pfCands->size(); j < n; ++j) {
+            const pat::PackedCandidate & pf = (*pfCands)[j];
+            int cat = pfIsolation::category(pf.pdgId(), pf.fromPV());
+            if (cat < 0) continue;
+            float eta = pf.eta();
+            if (eta < etaMin - maxCone_ || eta > etaMax + maxCone_) continue;
+            cands.eta.push_back(eta); cands.phi.push_back(pf.phi()); cands.pt.push_back(pf.pt()); cands.category.push_back(cat);
+            if (needsKeys_) cands.keys.push_back(matchingKey(pfCands.id(), j));
+        }
+    }
+    matching::EtaPhiGrid grid(cands.eta.data(), cands.phi.data(), cands.eta.size(), std::max(maxCone_, 0.01f));
+
+    // sums[i*niso*NCategories + k*NCategories + category] for lepton i and isolation k
+    std::vector<float> sums(nlep*niso*pfIsolation::NCategories, 0.f);
+    std::vector<uint64_t> leptonKeys;
+    for (unsigned int i = 0; i < nlep; ++i) {
+        const T & lep = (*src)[i];
+        if (needsKeys_) sourceCandidateKeys(lep, leptonKeys);
+        pfIsolation::addSums(isolations_, cands, grid, lep.eta(), lep.phi(), lep.pt(), leptonKeys, &sums[i*niso*pfIsolation::NCategories]);
+    }
+
+    for (unsigned int k = 0; k < niso; ++k) {
+        const pfIsolation::Isolation & iso = isolations_[k];
+        std::vector<float> chg(nlep), pu(nlep), neu(nlep), pho(nlep), all(nlep);
+        for (unsigned int i = 0; i < nlep; ++i) {
+            const float * lepSums = &sums[(i*niso + k)*pfIsolation::NCategories];
+            chg[i] = lepSums[pfIsolation::Charged]; pu[i] = lepSums[pfIsolation::PileUp];
+            neu[i] = lepSums[pfIsolation::Neutral]; pho[i] = lepSums[pfIsolation::Photon];
+            double correction = 0;
+            if (iso.puCorrection == pfIsolation::DeltaBeta) {
+                correction = iso.deltaBetaFactor * pu[i];
+            } else if (iso.puCorrection == pfIsolation::EffectiveArea) {
+                const T & lep = (*src)[i];
+                float r = iso.cone(lep.pt());
+                correction = rho * ea_->getEffectiveArea(std::abs(getEtaForEA(lep))) * std::pow(r/0.3, 2);
+            }
+            all[i] = chg[i] + std::max(0.0, neu[i] + pho[i] - correction);
+        }
+        const std::vector<float> * values[5] = { &chg, &neu, &pho, &pu, &all };
+        const char * what[5] = { "Chg", "Neu", "Pho", "PU", "All" };
+        for (unsigned int w = 0; w < 5; ++w) {
+            std::unique_ptr<edm::ValueMap<float>> out(new edm::ValueMap<float>());
+            edm::ValueMap<float>::Filler filler(*out);
+            filler.insert(src, values[w]->begin(), values[w]->end());
+            filler.fill();
+            iEvent.put(std::move(out), iso.name + what[w]);
+        }
+    }
+}
+
+template <typename T>
+void
+PFIsolationProducer<T>::fillDescriptions(edm::ConfigurationDescriptions& descriptions) {
+    edm::ParameterSetDescription desc;
+    desc.add<edm::InputTag>("src")->setComment("input lepton collection");
+    desc.add<edm::InputTag>("pfCands")->setComment("packed PF candidates");
+    desc.addOptional<edm::FileInPath>("EAFile")->setComment("effective areas for the isolations with puCorrection = effectiveArea (cone 0.3, scaled with the cone area)");
+    desc.addOptional<edm::InputTag>("rho")->setComment("rho for the isolations with puCorrection = effectiveArea");
+    edm::ParameterSetDescription iso;
+    iso.add<std::string>("name")->setComment("prefix of the output ValueMaps");
+    iso.add<std::string>("cone")->setComment("fixed (dR) or mini (ktScale/pt, within [dRMin, dRMax])");
+    iso.addOptional<double>("dR")->setComment("cone size, for fixed cones");
+    iso.addOptional<double>("ktScale")->setComment("pt times cone size, for mini cones");
+    iso.addOptional<double>("dRMin")->setComment("smallest cone size, for mini cones");
+    iso.addOptional<double>("dRMax")->setComment("largest cone size, for mini cones");
+    iso.add<double>("chargedVeto")->setComment("veto cone for charged hadrons from the PV (candidates with deltaR <= veto are not counted, none if negative)");
+    iso.add<double>("puVeto")->setComment("veto cone for charged hadrons from pileup");
+    iso.add<double>("neutralVeto")->setComment("veto cone for neutral hadrons");
+    iso.add<double>("photonVeto")->setComment("veto cone for photons");
+    iso.add<double>("ptThreshold")->setComment("pt threshold for neutral hadrons, photons and pileup");
+    iso.add<bool>("vetoSourceCandidates")->setComment("do not count the PF candidates of the lepton itself");
+    iso.add<std::string>("puCorrection")->setComment("none, deltaBeta or effectiveArea");
+    iso.addOptional<double>("deltaBetaFactor")->setComment("factor of the pileup sum subtracted with puCorrection = deltaBeta");
+    desc.addVPSet("isolations", iso)->setComment("isolations to compute");
+    std::string modname;
+    if (typeid(T) == typeid(pat::Muon)) modname+="Muon";
+    else if (typeid(T) == typeid(pat::Electron)) modname+="Ele";
+    modname+="PFIsolationProducer";
+    descriptions.add(modname,desc);
+}
+
+typedef PFIsolationProducer<pat::Muon> MuonPFIsolationProducer;
+typedef PFIsolationProducer<pat::Electron> ElePFIsolationProducer;
+
+//define this as a plug-in
+DEFINE_FWK_MODULE(MuonPFIsolationProducer);
+DEFINE_FWK_MODULE(ElePFIsolationProducer);
@@ -0,0 +1,82 @@
+#include "FWCore/Framework/interface/global/EDProducer.h"
+#include "FWCore/Framework/interface/Event.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/ParameterSet/interface/ConfigurationDescriptions.h"
+#include "FWCore/ParameterSet/interface/ParameterSetDescription.h"
+#include "DataFormats/VertexReco/interface/Vertex.h"
+#include "DataFormats/PatCandidates/interface/PackedCandidate.h"
+#include "DataFormats/PatCandidates/interface/Jet.h"
+#include "DataFormats/Candidate/interface/Candidate.h"
+#include "PhysicsTools/NanoAOD/interface/PackedCandidateTrackQuality.h"
+#include "PhysicsTools/NanoAOD/interface/MatchingUtils.h"
+
+/// Keeps the track quality of the constituents of the jets used by the lepton-jet variables (the leading jet sharing
+/// source candidates with each lepton, as in LeptonJetVarProducer), so that the pseudoTrack is built once per candidate,
+/// and only for the charged candidates from the PV with track details.
+class PackedCandidateTrackQualityProducer : public edm::global::EDProducer<> {
+    public:
+        PackedCandidateTrackQualityProducer( edm::ParameterSet const & params ) :
+            src_(consumes<std::vector<pat::PackedCandidate>>(params.getParameter<edm::InputTag>("src"))),
+            pvs_(consumes<std::vector<reco::Vertex>>(params.getParameter<edm::InputTag>("pvSrc"))),
+            jets_(consumes<edm::View<pat::Jet>>(params.getParameter<edm::InputTag>("srcJet"))),
+            leptons_(consumes<edm::View<reco::Candidate>>(params.getParameter<edm::InputTag>("srcLep")))
+        {
+            produces<PackedCandidateTrackQuality>();
+        }
+
+        ~PackedCandidateTrackQualityProducer() override {}
+
+        void produce(edm::StreamID, edm::Event& iEvent, const edm::EventSetup& iSetup) const override {
+            edm::Handle<std::vector<pat::PackedCandidate>> src;
+            iEvent.getByToken(src_, src);
+            edm::Handle<std::vector<reco::Vertex>> pvs;
+            iEvent.getByToken(pvs_, pvs);
+            const auto & pv = (*pvs)[0].position();
+            edm::Handle<edm::View<pat::Jet>> jets;
+            iEvent.getByToken(jets_, jets);
+            edm::Handle<edm::View<reco::Candidate>> leptons;
+            iEvent.getByToken(leptons_, leptons);
+
+            auto bySource = [](const auto & c, std::vector<uint64_t> & keys) { sourceCandidateKeys(c, keys); };
+            MatchingKeyIndex jetIndex(*jets, bySource);
+            std::vector<bool> used(jets->size(), false);
+            for (const auto & lep : *leptons) {
+                int ij = jetIndex.firstMatch(lep, bySource);
+                if (ij >= 0) used[ij] = true;
+            }
+
+            auto out = std::make_unique<PackedCandidateTrackQuality>(src.id(), src->size());
+            for (unsigned int ij = 0, nj = jets->size(); ij < nj; ++ij) {
+                if (!used[ij]) continue;
+                for (const auto & dau : (*jets)[ij].daughterPtrVector()) {
+                    if (dau.id() != src.id() || out->filled(dau.key())) continue;
+                    const pat::PackedCandidate & c = (*src)[dau.key()];
+                    out->setCandidate(dau.key(), c.eta(), c.phi(), c.charge() != 0, c.fromPV());
+                    if (c.charge() == 0 || c.fromPV() <= 1 || !c.hasTrackDetails()) continue;
+                    const reco::Track & tk = c.pseudoTrack();
+                    out->setTrack(dau.key(), tk.pt(), tk.hitPattern().numberOfValidHits(), tk.hitPattern().numberOfValidPixelHits(),
+                                  tk.normalizedChi2(), tk.dxy(pv), tk.dz(pv));
+                }
+            }
+
+            iEvent.put(std::move(out));
+        }
+
+        static void fillDescriptions(edm::ConfigurationDescriptions & descriptions) {
+            edm::ParameterSetDescription desc;
+            desc.add<edm::InputTag>("src")->setComment("packed PF candidates");
+            desc.add<edm::InputTag>("pvSrc")->setComment("primary vertices, the first one is used for dxy and dz");
+            desc.add<edm::InputTag>("srcJet")->setComment("jets, whose constituents are filled if a lepton uses them");
+            desc.add<edm::InputTag>("srcLep")->setComment("leptons");
+            descriptions.add("packedCandidateTrackQuality", desc);
+        }
+
+    protected:
+        const edm::EDGetTokenT<std::vector<pat::PackedCandidate>> src_;
+        const edm::EDGetTokenT<std::vector<reco::Vertex>> pvs_;
+        const edm::EDGetTokenT<edm::View<pat::Jet>> jets_;
+        const edm::EDGetTokenT<edm::View<reco::Candidate>> leptons_;
+};
+
+#include "FWCore/Framework/interface/MakerMacros.h"
+DEFINE_FWK_MODULE(PackedCandidateTrackQualityProducer);
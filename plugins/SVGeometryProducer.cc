@@ -0,0 +1,58 @@
+#include "FWCore/Framework/interface/global/EDProducer.h"
+#include "FWCore/Framework/interface/Event.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/ParameterSet/interface/ConfigurationDescriptions.h"
+#include "FWCore/ParameterSet/interface/ParameterSetDescription.h"
+#include "DataFormats/VertexReco/interface/Vertex.h"
+#include "DataFormats/Candidate/interface/VertexCompositePtrCandidate.h"
+#include "RecoVertex/VertexTools/interface/VertexDistance3D.h"
+#include "RecoVertex/VertexPrimitives/interface/ConvertToFromReco.h"
+#include "RecoVertex/VertexPrimitives/interface/VertexState.h"
+#include "PhysicsTools/NanoAOD/interface/SVGeometry.h"
+
+/// Computes the flight vector and the 3D distance from the main primary vertex of each secondary vertex once per event,
+/// for the vertex tables and the jet variables
+class SVGeometryProducer : public edm::global::EDProducer<> {
+    public:
+        SVGeometryProducer( edm::ParameterSet const & params ) :
+            pvs_(consumes<std::vector<reco::Vertex>>(params.getParameter<edm::InputTag>("pvSrc"))),
+            svs_(consumes<edm::View<reco::VertexCompositePtrCandidate>>(params.getParameter<edm::InputTag>("svSrc")))
+        {
+            produces<SVGeometry>();
+        }
+
+        ~SVGeometryProducer() override {}
+
+        void produce(edm::StreamID, edm::Event& iEvent, const edm::EventSetup& iSetup) const override {
+            edm::Handle<std::vector<reco::Vertex>> pvs;
+            iEvent.getByToken(pvs_, pvs);
+            edm::Handle<edm::View<reco::VertexCompositePtrCandidate>> svs;
+            iEvent.getByToken(svs_, svs);
+
+            auto out = std::make_unique<SVGeometry>(svs.id());
+            const reco::Vertex & pv = (*pvs)[0];
+            VertexDistance3D vdist;
+            for (const auto & sv : *svs) {
+                GlobalVector flightDir(sv.vertex().x() - pv.x(), sv.vertex().y() - pv.y(), sv.vertex().z() - pv.z());
+                Measurement1D dl = vdist.distance(pv, VertexState(RecoVertex::convertPos(sv.position()), RecoVertex::convertError(sv.error())));
+                out->push_back(flightDir.x(), flightDir.y(), flightDir.z(), flightDir.eta(), flightDir.phi(),
+                               dl.value(), dl.error(), sv.pt(), sv.p4().M(), sv.numberOfSourceCandidatePtrs());
+            }
+
+            iEvent.put(std::move(out));
+        }
+
+        static void fillDescriptions(edm::ConfigurationDescriptions & descriptions) {
+            edm::ParameterSetDescription desc;
+            desc.add<edm::InputTag>("pvSrc")->setComment("primary vertices, the first one is used");
+            desc.add<edm::InputTag>("svSrc")->setComment("secondary vertices");
+            descriptions.add("svGeometry", desc);
+        }
+
+    protected:
+        const edm::EDGetTokenT<std::vector<reco::Vertex>> pvs_;
+        const edm::EDGetTokenT<edm::View<reco::VertexCompositePtrCandidate>> svs_;
+};
+
+#include "FWCore/Framework/interface/MakerMacros.h"
+DEFINE_FWK_MODULE(SVGeometryProducer);
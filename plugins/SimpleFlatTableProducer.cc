@@ -1,4 +1,4 @@
-#include "FWCore/Framework/interface/stream/EDProducer.h"
+#include "FWCore/Framework/interface/global/EDProducer.h"
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
 #include "FWCore/Framework/interface/ConsumesCollector.h"
 #include "DataFormats/Common/interface/View.h"
@@ -9,10 +9,16 @@
 #include "CommonTools/Utils/interface/StringObjectFunction.h"
 
 #include <vector>
+#include <algorithm>
+#include <memory>
 #include <boost/ptr_container/ptr_vector.hpp>
+#include <tbb/task_group.h>
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+#include <tbb/task_arena.h>
 
 template<typename T, typename TProd>
-class SimpleFlatTableProducerBase : public edm::stream::EDProducer<> {
+class SimpleFlatTableProducerBase : public edm::global::EDProducer<> {
     public:
 
         SimpleFlatTableProducerBase( edm::ParameterSet const & params ):
@@ -21,16 +27,7 @@ class SimpleFlatTableProducerBase : public edm::stream::EDProducer<> {
             extension_(params.existsAs<bool>("extension") ? params.getParameter<bool>("extension") : false),
             src_(consumes<TProd>( params.getParameter<edm::InputTag>("src") )) 
         {
-            edm::ParameterSet const & varsPSet = params.getParameter<edm::ParameterSet>("variables");
-            for (const std::string & vname : varsPSet.getParameterNamesForType<edm::ParameterSet>()) {
-                const auto & varPSet = varsPSet.getParameter<edm::ParameterSet>(vname);
-                const std::string & type = varPSet.getParameter<std::string>("type");
-                if (type == "int") vars_.push_back(new IntVar(vname, FlatTable::IntColumn, varPSet));
-                else if (type == "float") vars_.push_back(new FloatVar(vname, FlatTable::FloatColumn, varPSet));
-                else if (type == "uint8") vars_.push_back(new BoolVar(vname, FlatTable::UInt8Column, varPSet));
-                else if (type == "bool") vars_.push_back(new BoolVar(vname, FlatTable::BoolColumn, varPSet));
-                else throw cms::Exception("Configuration", "unsupported type "+type+" for variable "+vname);
-            }
+            makeVariables(params.getParameter<edm::ParameterSet>("variables"), vars_);
 
             produces<FlatTable>();
         }
@@ -41,7 +38,7 @@ class SimpleFlatTableProducerBase : public edm::stream::EDProducer<> {
         virtual std::unique_ptr<FlatTable> fillTable(const edm::Event &iEvent, const edm::Handle<TProd> & prod) const = 0;
 
 
-        void produce(edm::Event& iEvent, const edm::EventSetup& iSetup) override {
+        void produce(edm::StreamID, edm::Event& iEvent, const edm::EventSetup& iSetup) const override {
             edm::Handle<TProd> src;
             iEvent.getByToken(src_, src);
 
@@ -76,7 +73,16 @@ class SimpleFlatTableProducerBase : public edm::stream::EDProducer<> {
             public:
                 Variable(const std::string & aname, FlatTable::ColumnType atype, const edm::ParameterSet & cfg) : 
                     VariableBase(aname, atype, cfg) {}
-                virtual void fill(std::vector<const T *> selobjs, FlatTable & out) const = 0;
+                /// add the (still empty) output column to the table, and return its index
+                virtual unsigned int reserve(FlatTable & out) const = 0;
+                /// fill the rows [begin, end) of a column made with reserve(); different variables, or different rows, can be filled concurrently
+                virtual void fillRows(const std::vector<const T *> & selobjs, FlatTable & out, unsigned int column, unsigned int begin, unsigned int end) const = 0;
+                /// to be called once all the rows of the column are filled
+                virtual void reducePrecision(FlatTable & out, unsigned int column) const = 0;
+                void fill(const std::vector<const T *> & selobjs, FlatTable & out, unsigned int column) const {
+                    fillRows(selobjs, out, column, 0, selobjs.size());
+                    reducePrecision(out, column);
+                }
         };
         template<typename StringFunctor, typename ValType>
             class FuncVariable : public Variable {
@@ -84,12 +90,17 @@ class SimpleFlatTableProducerBase : public edm::stream::EDProducer<> {
                     FuncVariable(const std::string & aname, FlatTable::ColumnType atype, const edm::ParameterSet & cfg) :
                         Variable(aname, atype, cfg), func_(cfg.getParameter<std::string>("expr"), true) {}
                     ~FuncVariable() override {}
-                    void fill(std::vector<const T *> selobjs, FlatTable & out) const override {
-                        std::vector<ValType> vals(selobjs.size());
-                        for (unsigned int i = 0, n = vals.size(); i < n; ++i) {
+                    unsigned int reserve(FlatTable & out) const override {
+                        return out.template reserveColumn<ValType>(this->name_, this->doc_, this->type_);
+                    }
+                    void fillRows(const std::vector<const T *> & selobjs, FlatTable & out, unsigned int column, unsigned int begin, unsigned int end) const override {
+                        auto vals = out.template columnData<ValType>(column);
+                        for (unsigned int i = begin; i < end; ++i) {
                             vals[i] = func_(*selobjs[i]);
                         }
-                        out.template addColumn<ValType>(this->name_, vals, this->doc_, this->type_,this->precision_);
+                    }
+                    void reducePrecision(FlatTable & out, unsigned int column) const override {
+                        out.template reduceColumnPrecision<ValType>(column, this->precision_);
                     }
                 protected:
                     StringFunctor func_;
@@ -99,6 +110,18 @@ class SimpleFlatTableProducerBase : public edm::stream::EDProducer<> {
         typedef FuncVariable<StringObjectFunction<T>,float> FloatVar;
         typedef FuncVariable<StringCutObjectSelector<T>,uint8_t> BoolVar;
         boost::ptr_vector<Variable> vars_;
+
+        static void makeVariables(const edm::ParameterSet & varsPSet, boost::ptr_vector<Variable> & vars) {
+            for (const std::string & vname : varsPSet.getParameterNamesForType<edm::ParameterSet>()) {
+                const auto & varPSet = varsPSet.getParameter<edm::ParameterSet>(vname);
+                const std::string & type = varPSet.getParameter<std::string>("type");
+                if (type == "int") vars.push_back(new IntVar(vname, FlatTable::IntColumn, varPSet));
+                else if (type == "float") vars.push_back(new FloatVar(vname, FlatTable::FloatColumn, varPSet));
+                else if (type == "uint8") vars.push_back(new BoolVar(vname, FlatTable::UInt8Column, varPSet));
+                else if (type == "bool") vars.push_back(new BoolVar(vname, FlatTable::BoolColumn, varPSet));
+                else throw cms::Exception("Configuration", "unsupported type "+type+" for variable "+vname);
+            }
+        }
 };
 
 template<typename T>
@@ -110,20 +133,15 @@ class SimpleFlatTableProducer : public SimpleFlatTableProducerBase<T, edm::View<
             SimpleFlatTableProducerBase<T, edm::View<T>>(params),
             singleton_(params.getParameter<bool>("singleton")),
             maxLen_(params.existsAs<unsigned int>("maxLen") ? params.getParameter<unsigned int>("maxLen") : std::numeric_limits<unsigned int>::max()),
-            cut_(!singleton_ ? params.getParameter<std::string>("cut") : "", true) 
+            cut_(!singleton_ ? params.getParameter<std::string>("cut") : "", true),
+            sortBy_(params.existsAs<std::string>("sortBy") ? params.getParameter<std::string>("sortBy") : ""),
+            sortDescending_(params.existsAs<bool>("sortDescending") ? params.getParameter<bool>("sortDescending") : true),
+            minRowsForParallelFill_(params.existsAs<unsigned int>("minRowsForParallelFill") ? params.getParameter<unsigned int>("minRowsForParallelFill") : 200)
         {
+            if (!sortBy_.empty() && singleton_) throw cms::Exception("Configuration", "sortBy is not supported for singleton tables");
+            if (!sortBy_.empty()) sortFunc_.reset(new StringObjectFunction<T>(sortBy_, true));
             if (params.existsAs<edm::ParameterSet>("externalVariables")) {
-                edm::ParameterSet const & extvarsPSet = params.getParameter<edm::ParameterSet>("externalVariables");
-                for (const std::string & vname : extvarsPSet.getParameterNamesForType<edm::ParameterSet>()) {
-                    const auto & varPSet = extvarsPSet.getParameter<edm::ParameterSet>(vname);
-                    const std::string & type = varPSet.getParameter<std::string>("type");
-                    if (type == "int") extvars_.push_back(new IntExtVar(vname, FlatTable::IntColumn, varPSet, this->consumesCollector()));
-                    else if (type == "float") extvars_.push_back(new FloatExtVar(vname, FlatTable::FloatColumn, varPSet, this->consumesCollector()));
-                    else if (type == "double") extvars_.push_back(new DoubleExtVar(vname, FlatTable::FloatColumn, varPSet, this->consumesCollector()));
-                    else if (type == "uint8") extvars_.push_back(new UInt8ExtVar(vname, FlatTable::UInt8Column, varPSet, this->consumesCollector()));
-                    else if (type == "bool") extvars_.push_back(new BoolExtVar(vname, FlatTable::BoolColumn, varPSet, this->consumesCollector()));
-                    else throw cms::Exception("Configuration", "unsupported type "+type+" for variable "+vname);
-                }
+                makeExtVariables(params.getParameter<edm::ParameterSet>("externalVariables"), extvars_);
             }
         }
 
@@ -131,51 +149,159 @@ class SimpleFlatTableProducer : public SimpleFlatTableProducerBase<T, edm::View<
 
         std::unique_ptr<FlatTable> fillTable(const edm::Event &iEvent, const edm::Handle<edm::View<T>> & prod) const override {
             std::vector<const T *> selobjs;
-            std::vector<edm::Ptr<T>> selptrs; // for external variables
+            std::vector<unsigned int> selidx; // index in the input collection, for external variables (always increasing)
+            select(*prod, selobjs, selidx);
+            auto out = std::make_unique<FlatTable>(selobjs.size(), this->name_, singleton_, this->extension_);
+            // make all the columns first, so that they can then be filled independently
+            std::vector<unsigned int> cols, extcols;
+            for (const auto & var : this->vars_) cols.push_back(var.reserve(*out));
+            for (const auto & var : this->extvars_) extcols.push_back(var.reserve(*out));
+            const bool identity = !this->extvars_.empty() && isIdentity(*prod);
+            auto fillVar = [&](unsigned int iv) { this->vars_[iv].fill(selobjs, *out, cols[iv]); };
+            if (selobjs.size() >= minRowsForParallelFill_ && this->vars_.size() > 1) {
+                // isolated, so that while waiting this thread only runs our own tasks and not other modules
+                tbb::this_task_arena::isolate([&]() {
+                    tbb::task_group tasks;
+                    for (unsigned int iv = 0, nv = this->vars_.size(); iv < nv; ++iv) {
+                        tasks.run([&, iv]() { fillVar(iv); });
+                    }
+                    // external variables need to read from the event, so they're filled here while the tasks run
+                    try {
+                        for (unsigned int iv = 0, nv = this->extvars_.size(); iv < nv; ++iv) {
+                            this->extvars_[iv].fill(iEvent, prod, identity, selidx, *out, extcols[iv]);
+                        }
+                    } catch (...) {
+                        tasks.cancel(); tasks.wait();
+                        throw;
+                    }
+                    tasks.wait();
+                });
+            } else {
+                for (unsigned int iv = 0, nv = this->vars_.size(); iv < nv; ++iv) fillVar(iv);
+                for (unsigned int iv = 0, nv = this->extvars_.size(); iv < nv; ++iv) this->extvars_[iv].fill(iEvent, prod, identity, selidx, *out, extcols[iv]);
+            }
+            return out;
+        } 
+
+        void select(const edm::View<T> & prod, std::vector<const T *> & selobjs, std::vector<unsigned int> & selidx) const {
             if (singleton_) { 
-                assert(prod->size() == 1);
-                selobjs.push_back(& (*prod)[0] );
-                if (!extvars_.empty()) selptrs.emplace_back(prod->ptrAt(0));
+                assert(prod.size() == 1);
+                selobjs.push_back(& prod[0] );
+                selidx.push_back(0);
+            } else if (sortFunc_) {
+                selectTopN(prod, selobjs, selidx);
             } else {
-                for (unsigned int i = 0, n = prod->size(); i < n; ++i) {
-                    const auto & obj = (*prod)[i];
+                for (unsigned int i = 0, n = prod.size(); i < n; ++i) {
+                    const auto & obj = prod[i];
                     if (cut_(obj)) { 
                         selobjs.push_back(&obj); 
-                        if (!extvars_.empty()) selptrs.emplace_back(prod->ptrAt(i));
+                        selidx.push_back(i);
                     }
 		    if(selobjs.size()>=maxLen_) break;
                 }
             }
-            auto out = std::make_unique<FlatTable>(selobjs.size(), this->name_, singleton_, this->extension_);
-            for (const auto & var : this->vars_) var.fill(selobjs, *out);
-            for (const auto & var : this->extvars_) var.fill(iEvent, selptrs, *out);
-            return out;
-        } 
+        }
+
+        /// select the objects passing the cut, keeping only the first maxLen_ ones according to sortFunc_.
+        /// the selected objects are returned in input order, so that indices in the table follow the ones of the input collection
+        void selectTopN(const edm::View<T> & prod, std::vector<const T *> & selobjs, std::vector<unsigned int> & selidx) const {
+            std::vector<std::pair<float,unsigned int>> keys;
+            for (unsigned int i = 0, n = prod.size(); i < n; ++i) {
+                const auto & obj = prod[i];
+                if (cut_(obj)) keys.emplace_back((*sortFunc_)(obj), i);
+            }
+            if (keys.size() > maxLen_) {
+                // ties are broken by the input index, so that the result does not depend on the nth_element implementation
+                if (sortDescending_) {
+                    std::nth_element(keys.begin(), keys.begin()+maxLen_, keys.end(), [](const std::pair<float,unsigned int> & a, const std::pair<float,unsigned int> & b) {
+                            return a.first > b.first || (a.first == b.first && a.second < b.second); });
+                } else {
+                    std::nth_element(keys.begin(), keys.begin()+maxLen_, keys.end(), [](const std::pair<float,unsigned int> & a, const std::pair<float,unsigned int> & b) {
+                            return a.first < b.first || (a.first == b.first && a.second < b.second); });
+                }
+                keys.resize(maxLen_);
+            }
+            selidx.reserve(keys.size()); selobjs.reserve(keys.size());
+            for (const auto & k : keys) selidx.push_back(k.second);
+            std::sort(selidx.begin(), selidx.end());
+            for (unsigned int i : selidx) selobjs.push_back(&prod[i]);
+        }
 
     protected:
         bool  singleton_;
 	const unsigned int maxLen_;
         const StringCutObjectSelector<T> cut_;
+        const std::string sortBy_;
+        const bool sortDescending_;
+        std::unique_ptr<StringObjectFunction<T>> sortFunc_; // if set, maxLen keeps the objects with the largest (or smallest) value of sortBy
+        const unsigned int minRowsForParallelFill_; // tables with fewer rows are filled one variable after the other
 
         class ExtVariable : public base::VariableBase {
             public:
                 ExtVariable(const std::string & aname, FlatTable::ColumnType atype, const edm::ParameterSet & cfg) : 
                     base::VariableBase(aname, atype, cfg) {}
-                virtual void fill(const edm::Event & iEvent, std::vector<edm::Ptr<T>> selptrs, FlatTable & out) const = 0;
+                virtual unsigned int reserve(FlatTable & out) const = 0;
+                virtual void fill(const edm::Event & iEvent, const edm::Handle<edm::View<T>> & prod, bool identity, const std::vector<unsigned int> & selidx, FlatTable & out, unsigned int column) const = 0;
         };
+        /// true if the objects of the View are the objects of a single product, in their order (ref i has key i),
+        /// as for a View of a collection read directly from the event; then the values of a ValueMap can be read by position
+        static bool isIdentity(const edm::View<T> & prod) {
+            if (prod.empty()) return true;
+            const edm::ProductID id = prod.refAt(0).id();
+            for (unsigned int i = 0, n = prod.size(); i < n; ++i) {
+                auto ref = prod.refAt(i);
+                if (ref.key() != i || ref.id() != id) return false;
+            }
+            return true;
+        }
+        /// copy into vals the values of vmap for the objects selidx of prod, looking up the position of each product in the map only once.
+        /// identity must be the result of isIdentity(*prod), computed once per event
+        template<typename TIn, typename Range>
+        static void gatherFromValueMap(const edm::ValueMap<TIn> & vmap, const edm::Handle<edm::View<T>> & prod, bool identity, const std::vector<unsigned int> & selidx, Range vals) {
+            if (selidx.empty()) return;
+            auto mapEnd = vmap.end();
+            // a map filled from this same View (e.g. of a RefVector selection) is keyed by the product of the View
+            auto it = vmap.begin();
+            while (it != mapEnd && it.id() != prod.id()) ++it;
+            if (it == mapEnd && identity) {
+                const edm::ProductID id = prod->refAt(0).id();
+                for (it = vmap.begin(); it != mapEnd && it.id() != id; ++it) {}
+                if (it == mapEnd) throw cms::Exception("LogicError") << "ValueMap does not contain values for product " << id << "\n";
+            }
+            if (it != mapEnd) {
+                // the values are in the same order as the objects of the View
+                auto first = it.begin();
+                if (selidx.size() == prod->size()) { // no object was dropped, so selidx is the identity
+                    std::copy(first, first + selidx.size(), vals.begin());
+                } else {
+                    for (unsigned int i = 0, n = selidx.size(); i < n; ++i) vals[i] = *(first + selidx[i]);
+                }
+                return;
+            }
+            // otherwise, the map is keyed by the products that the objects of the View point to
+            auto current = mapEnd;
+            for (unsigned int i = 0, n = selidx.size(); i < n; ++i) {
+                auto ptr = prod->ptrAt(selidx[i]);
+                if (current == mapEnd || current.id() != ptr.id()) {
+                    for (current = vmap.begin(); current != mapEnd && current.id() != ptr.id(); ++current) {}
+                    if (current == mapEnd) throw cms::Exception("LogicError") << "ValueMap does not contain values for product " << ptr.id() << "\n";
+                }
+                vals[i] = *(current.begin() + ptr.key());
+            }
+        }
         template<typename TIn, typename ValType=TIn>
         class ValueMapVariable : public ExtVariable {
             public:
                 ValueMapVariable(const std::string & aname, FlatTable::ColumnType atype, const edm::ParameterSet & cfg, edm::ConsumesCollector && cc) : 
                     ExtVariable(aname, atype, cfg), token_(cc.consumes<edm::ValueMap<TIn>>(cfg.getParameter<edm::InputTag>("src"))) {}
-                void fill(const edm::Event & iEvent, std::vector<edm::Ptr<T>> selptrs, FlatTable & out) const override {
+                unsigned int reserve(FlatTable & out) const override {
+                    return out.template reserveColumn<ValType>(this->name_, this->doc_, this->type_);
+                }
+                void fill(const edm::Event & iEvent, const edm::Handle<edm::View<T>> & prod, bool identity, const std::vector<unsigned int> & selidx, FlatTable & out, unsigned int column) const override {
                     edm::Handle<edm::ValueMap<TIn>> vmap;
                     iEvent.getByToken(token_, vmap);
-                    std::vector<ValType> vals(selptrs.size());   
-                    for (unsigned int i = 0, n = vals.size(); i < n; ++i) {
-                        vals[i] = (*vmap)[selptrs[i]];
-                    }
-                    out.template addColumn<ValType>(this->name_, vals, this->doc_, this->type_, this->precision_);
+                    SimpleFlatTableProducer<T>::gatherFromValueMap(*vmap, prod, identity, selidx, out.template columnData<ValType>(column));
+                    out.template reduceColumnPrecision<ValType>(column, this->precision_);
                 }
             protected:
                 edm::EDGetTokenT<edm::ValueMap<TIn>> token_;
@@ -187,6 +313,109 @@ class SimpleFlatTableProducer : public SimpleFlatTableProducerBase<T, edm::View<
         typedef ValueMapVariable<int,uint8_t> UInt8ExtVar;
         boost::ptr_vector<ExtVariable> extvars_;
 
+        void makeExtVariables(const edm::ParameterSet & extvarsPSet, boost::ptr_vector<ExtVariable> & extvars) {
+            for (const std::string & vname : extvarsPSet.getParameterNamesForType<edm::ParameterSet>()) {
+                const auto & varPSet = extvarsPSet.getParameter<edm::ParameterSet>(vname);
+                const std::string & type = varPSet.getParameter<std::string>("type");
+                if (type == "int") extvars.push_back(new IntExtVar(vname, FlatTable::IntColumn, varPSet, this->consumesCollector()));
+                else if (type == "float") extvars.push_back(new FloatExtVar(vname, FlatTable::FloatColumn, varPSet, this->consumesCollector()));
+                else if (type == "double") extvars.push_back(new DoubleExtVar(vname, FlatTable::FloatColumn, varPSet, this->consumesCollector()));
+                else if (type == "uint8") extvars.push_back(new UInt8ExtVar(vname, FlatTable::UInt8Column, varPSet, this->consumesCollector()));
+                else if (type == "bool") extvars.push_back(new BoolExtVar(vname, FlatTable::BoolColumn, varPSet, this->consumesCollector()));
+                else throw cms::Exception("Configuration", "unsupported type "+type+" for variable "+vname);
+            }
+        }
+};
+
+/// Fills several tables from the same collection and selection: the main one, configured as for SimpleFlatTableProducer,
+/// and the ones in "tables", each put in the event with its own product instance label.
+/// The columns of all the tables are filled together, one block of objects at a time, instead of one module per table
+template<typename T>
+class SimpleFlatTableGroupProducer : public SimpleFlatTableProducer<T> {
+    public:
+        typedef SimpleFlatTableProducerBase<T, edm::View<T>> base;
+
+        SimpleFlatTableGroupProducer( edm::ParameterSet const & params ) :
+            SimpleFlatTableProducer<T>(params),
+            blockSize_(params.existsAs<unsigned int>("blockSize") ? params.getParameter<unsigned int>("blockSize") : 64)
+        {
+            for (const edm::ParameterSet & tablePSet : params.getParameter<std::vector<edm::ParameterSet>>("tables")) {
+                tables_.push_back(new TableDef());
+                TableDef & table = tables_.back();
+                table.label = tablePSet.getParameter<std::string>("label");
+                table.name = tablePSet.getParameter<std::string>("name");
+                table.doc = tablePSet.existsAs<std::string>("doc") ? tablePSet.getParameter<std::string>("doc") : "";
+                table.extension = tablePSet.existsAs<bool>("extension") ? tablePSet.getParameter<bool>("extension") : false;
+                base::makeVariables(tablePSet.getParameter<edm::ParameterSet>("variables"), table.vars);
+                if (tablePSet.existsAs<edm::ParameterSet>("externalVariables")) {
+                    this->makeExtVariables(tablePSet.getParameter<edm::ParameterSet>("externalVariables"), table.extvars);
+                }
+                this->template produces<FlatTable>(table.label);
+            }
+        }
+
+        ~SimpleFlatTableGroupProducer() override {}
+
+        void produce(edm::StreamID, edm::Event& iEvent, const edm::EventSetup& iSetup) const override {
+            edm::Handle<edm::View<T>> prod;
+            iEvent.getByToken(this->src_, prod);
+
+            std::vector<const T *> selobjs;
+            std::vector<unsigned int> selidx;
+            this->select(*prod, selobjs, selidx);
+
+            // the main table goes first, with the same content as the one of SimpleFlatTableProducer
+            unsigned int ntables = tables_.size()+1;
+            std::vector<const boost::ptr_vector<typename base::Variable> *> vars(1, &this->vars_);
+            std::vector<const boost::ptr_vector<typename SimpleFlatTableProducer<T>::ExtVariable> *> extvars(1, &this->extvars_);
+            std::vector<std::unique_ptr<FlatTable>> out;
+            out.push_back(std::make_unique<FlatTable>(selobjs.size(), this->name_, this->singleton_, this->extension_));
+            out.back()->setDoc(this->doc_);
+            for (const TableDef & table : tables_) {
+                vars.push_back(&table.vars); extvars.push_back(&table.extvars);
+                out.push_back(std::make_unique<FlatTable>(selobjs.size(), table.name, this->singleton_, table.extension));
+                out.back()->setDoc(table.doc);
+            }
+            std::vector<std::vector<unsigned int>> cols(ntables);
+            for (unsigned int it = 0; it < ntables; ++it) {
+                for (const auto & var : *vars[it]) cols[it].push_back(var.reserve(*out[it]));
+            }
+
+            // all the columns of all the tables for one block of objects, then the next block
+            auto fillBlock = [&](unsigned int begin, unsigned int end) {
+                for (unsigned int it = 0; it < ntables; ++it) {
+                    for (unsigned int iv = 0, nv = vars[it]->size(); iv < nv; ++iv) (*vars[it])[iv].fillRows(selobjs, *out[it], cols[it][iv], begin, end);
+                }
+            };
+            if (selobjs.size() >= this->minRowsForParallelFill_) {
+                tbb::this_task_arena::isolate([&]() {
+                    tbb::parallel_for(tbb::blocked_range<unsigned int>(0, selobjs.size(), blockSize_), 
+                            [&](const tbb::blocked_range<unsigned int> & r) { fillBlock(r.begin(), r.end()); });
+                });
+            } else {
+                fillBlock(0, selobjs.size());
+            }
+            bool hasExtVars = false;
+            for (const auto * ev : extvars) hasExtVars = hasExtVars || !ev->empty();
+            const bool identity = hasExtVars && SimpleFlatTableProducer<T>::isIdentity(*prod);
+            for (unsigned int it = 0; it < ntables; ++it) {
+                for (unsigned int iv = 0, nv = vars[it]->size(); iv < nv; ++iv) (*vars[it])[iv].reducePrecision(*out[it], cols[it][iv]);
+                for (const auto & var : *extvars[it]) var.fill(iEvent, prod, identity, selidx, *out[it], var.reserve(*out[it]));
+            }
+
+            iEvent.put(std::move(out.front()));
+            for (unsigned int it = 1; it < ntables; ++it) iEvent.put(std::move(out[it]), tables_[it-1].label);
+        }
+
+    protected:
+        struct TableDef {
+            std::string label, name, doc;
+            bool extension;
+            boost::ptr_vector<typename base::Variable> vars;
+            boost::ptr_vector<typename SimpleFlatTableProducer<T>::ExtVariable> extvars;
+        };
+        boost::ptr_vector<TableDef> tables_;
+        const unsigned int blockSize_;
 };
 
 template<typename T>
@@ -200,7 +429,7 @@ class EventSingletonSimpleFlatTableProducer : public SimpleFlatTableProducerBase
         std::unique_ptr<FlatTable> fillTable(const edm::Event &, const edm::Handle<T> & prod) const override {
             auto out = std::make_unique<FlatTable>(1, this->name_, true, this->extension_);
             std::vector<const T *> selobjs(1, prod->product());
-            for (const auto & var : this->vars_) var.fill(selobjs, *out);
+            for (const auto & var : this->vars_) var.fill(selobjs, *out, var.reserve(*out));
             return out;
         }
 };
@@ -210,4 +439,6 @@ typedef SimpleFlatTableProducer<reco::Candidate> SimpleCandidateFlatTableProduce
 
 #include "FWCore/Framework/interface/MakerMacros.h"
 DEFINE_FWK_MODULE(SimpleCandidateFlatTableProducer);
+typedef SimpleFlatTableGroupProducer<reco::Candidate> SimpleCandidateFlatTableGroupProducer;
+DEFINE_FWK_MODULE(SimpleCandidateFlatTableGroupProducer);
 
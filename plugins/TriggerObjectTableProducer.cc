@@ -1,38 +1,62 @@
 // system include files
 #include <memory>
 #include <sstream>
+#include <map>
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
 
 // user include files
 #include "FWCore/Framework/interface/Frameworkfwd.h"
 #include "FWCore/Framework/interface/global/EDProducer.h"
 
 #include "FWCore/Framework/interface/Event.h"
+#include "FWCore/Framework/interface/Run.h"
 #include "FWCore/Framework/interface/MakerMacros.h"
 
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
 #include "FWCore/Utilities/interface/StreamID.h"
 
 #include "DataFormats/PatCandidates/interface/TriggerObjectStandAlone.h"
+#include "DataFormats/Common/interface/TriggerResults.h"
+#include "HLTrigger/HLTcore/interface/HLTConfigProvider.h"
 #include "CommonTools/Utils/interface/StringCutObjectSelector.h"
 #include "CommonTools/Utils/interface/StringObjectFunction.h"
 #include "DataFormats/Math/interface/deltaR.h"
 #include "PhysicsTools/NanoAOD/interface/FlatTable.h"
+#include "PhysicsTools/NanoAOD/interface/CandidateKinematics.h"
+#include "PhysicsTools/NanoAOD/interface/MatchingUtils.h"
 
-class TriggerObjectTableProducer : public edm::global::EDProducer<> {
+namespace {
+    /// for each filter label of the HLT menu, the bitmask of the filter patterns (with wildcards) that match it
+    struct FilterPatternBits {
+        std::unordered_map<std::string,uint64_t> labelBits;
+    };
+}
+
+class TriggerObjectTableProducer : public edm::global::EDProducer<edm::RunCache<FilterPatternBits>> {
     public:
         explicit TriggerObjectTableProducer(const edm::ParameterSet &iConfig) :
             name_(iConfig.getParameter<std::string>("name")),
-            src_(consumes<std::vector<pat::TriggerObjectStandAlone>>(iConfig.getParameter<edm::InputTag>("src")))
+            src_(consumes<std::vector<pat::TriggerObjectStandAlone>>(iConfig.getParameter<edm::InputTag>("src"))),
+            hltProcess_(iConfig.existsAs<std::string>("hltProcess") ? iConfig.getParameter<std::string>("hltProcess") : "HLT")
         {
+            // with unpackFilterLabels, the filter labels are unpacked here, with the trigger results of hltProcess, and only for the objects that need them
+            lazyUnpack_ = iConfig.existsAs<bool>("unpackFilterLabels") && iConfig.getParameter<bool>("unpackFilterLabels");
+            if (lazyUnpack_) triggerResults_ = consumes<edm::TriggerResults>(edm::InputTag("TriggerResults", "", hltProcess_));
+            // kinematics of the objects of src, if already made by a CandidateKinematicsProducer from the same src
+            if (iConfig.existsAs<edm::InputTag>("kinematics")) {
+                kinematics_ = consumes<CandidateKinematics>(iConfig.getParameter<edm::InputTag>("kinematics"));
+            }
             std::vector<edm::ParameterSet> selPSets = iConfig.getParameter<std::vector<edm::ParameterSet>>("selections");
             sels_.reserve(selPSets.size());
             std::stringstream idstr, qualitystr;
             idstr << "ID of the object: ";
             for (auto & pset : selPSets) {
-                sels_.emplace_back(pset);
+                sels_.emplace_back(pset, patterns_);
                 idstr << sels_.back().id << " = " << sels_.back().name;
                 if (sels_.size() < selPSets.size()) idstr << ", ";
-                if (!sels_.back().qualityBitsDoc.empty()) { 
+                if (!sels_.back().qualityBitsDoc.empty()) {
                     qualitystr << sels_.back().qualityBitsDoc << " for " << sels_.back().name << "; ";
                 }
             }
@@ -47,28 +71,61 @@ class TriggerObjectTableProducer : public edm::global::EDProducer<> {
     private:
         void produce(edm::StreamID, edm::Event&, edm::EventSetup const&) const override ;
 
+        std::shared_ptr<FilterPatternBits> globalBeginRun(edm::Run const& iRun, edm::EventSetup const& iSetup) const override ;
+        void globalEndRun(edm::Run const&, edm::EventSetup const&) const override { }
+
+        /// glob-style match, with '*' matching any sequence of characters (as in TriggerObjectStandAlone::hasFilterLabel)
+        static bool wildcardMatch(const char * pattern, const char * label) ;
+        /// bitmask of the patterns matching a filter label
+        uint64_t patternBits(const FilterPatternBits & cache, const std::string & label) const ;
+
         std::string name_;
         edm::EDGetTokenT<std::vector<pat::TriggerObjectStandAlone>> src_;
+        edm::EDGetTokenT<edm::TriggerResults> triggerResults_;
+        bool lazyUnpack_;
+        edm::EDGetTokenT<CandidateKinematics> kinematics_;
+        std::string hltProcess_;
         std::string idDoc_, bitsDoc_;
+        std::vector<std::string> patterns_; // all the filter patterns used by the selections
 
         struct SelectedObject {
             std::string name;
             int id;
-            StringCutObjectSelector<pat::TriggerObjectStandAlone> cut;
+            // either a string cut and function...
+            std::unique_ptr<StringCutObjectSelector<pat::TriggerObjectStandAlone>> cut;
+            std::unique_ptr<StringObjectFunction<pat::TriggerObjectStandAlone>> qualityBits;
+            // ...or a structured selection, evaluated on the bitmask of the patterns matching the filter labels of the object
+            int type;
+            float ptMin;
+            std::string coll;
+            uint64_t filtersMask, vetoFiltersMask;
+            std::vector<uint64_t> qualityBitsMasks; // bit i of the quality bits is set if the object matches the pattern in qualityBitsMasks[i]
             StringCutObjectSelector<pat::TriggerObjectStandAlone> l1cut, l2cut;
             float       l1DR2, l2DR2;
-            StringObjectFunction<pat::TriggerObjectStandAlone> qualityBits;
             std::string qualityBitsDoc;
 
-            SelectedObject(const edm::ParameterSet & pset) :
+            SelectedObject(const edm::ParameterSet & pset, std::vector<std::string> & patterns) :
                 name(pset.getParameter<std::string>("name")),
                 id(pset.getParameter<int>("id")),
-                cut(pset.getParameter<std::string>("sel")),
+                type(0), ptMin(0), filtersMask(0), vetoFiltersMask(0),
                 l1cut(""), l2cut(""),
                 l1DR2(-1), l2DR2(-1),
-                qualityBits(pset.getParameter<std::string>("qualityBits")),
                 qualityBitsDoc(pset.getParameter<std::string>("qualityBitsDoc"))
             {
+                if (pset.existsAs<std::string>("sel")) {
+                    cut.reset(new StringCutObjectSelector<pat::TriggerObjectStandAlone>(pset.getParameter<std::string>("sel")));
+                } else {
+                    type = pset.getParameter<int>("type");
+                    ptMin = pset.getParameter<double>("ptMin");
+                    coll = pset.existsAs<std::string>("coll") ? pset.getParameter<std::string>("coll") : "";
+                    for (const auto & pattern : pset.getParameter<std::vector<std::string>>("filters")) filtersMask |= patternMask(pattern, patterns);
+                    for (const auto & pattern : pset.getParameter<std::vector<std::string>>("vetoFilters")) vetoFiltersMask |= patternMask(pattern, patterns);
+                }
+                if (pset.existsAs<std::string>("qualityBits")) {
+                    qualityBits.reset(new StringObjectFunction<pat::TriggerObjectStandAlone>(pset.getParameter<std::string>("qualityBits")));
+                } else {
+                    for (const auto & pattern : pset.getParameter<std::vector<std::string>>("qualityBitsFilters")) qualityBitsMasks.push_back(patternMask(pattern, patterns));
+                }
                 if (pset.existsAs<std::string>("l1seed")) {
                     l1cut = StringCutObjectSelector<pat::TriggerObjectStandAlone>(pset.getParameter<std::string>("l1seed"));
                     l1DR2 = std::pow(pset.getParameter<double>("l1deltaR"), 2);
@@ -79,60 +136,196 @@ class TriggerObjectTableProducer : public edm::global::EDProducer<> {
                 }
             }
 
-            bool match(const pat::TriggerObjectStandAlone & obj) const {
-                return cut(obj);
+            static uint64_t patternMask(const std::string & pattern, std::vector<std::string> & patterns) {
+                auto match = std::find(patterns.begin(), patterns.end(), pattern);
+                if (match == patterns.end()) {
+                    if (patterns.size() == 64) throw cms::Exception("Configuration", "At most 64 different filter patterns are supported\n");
+                    patterns.push_back(pattern); 
+                    match = patterns.end()-1; 
+                }
+                return uint64_t(1) << (match - patterns.begin());
+            }
+
+            /// cuts that do not need the filter labels
+            bool preselect(const pat::TriggerObjectStandAlone & obj) const {
+                if (cut) return true;
+                return obj.pt() > ptMin && (coll.empty() || obj.hasCollection(coll));
+            }
+            bool match(const pat::TriggerObjectStandAlone & obj, uint64_t bits) const {
+                if (cut) return (*cut)(obj);
+                return (bits & filtersMask) == filtersMask && (bits & vetoFiltersMask) == 0;
+            }
+            int computeQualityBits(const pat::TriggerObjectStandAlone & obj, uint64_t bits) const {
+                if (qualityBits) return (*qualityBits)(obj);
+                int ret = 0;
+                for (unsigned int i = 0, n = qualityBitsMasks.size(); i < n; ++i) {
+                    if (bits & qualityBitsMasks[i]) ret |= (1 << i);
+                }
+                return ret;
             }
         };
 
         std::vector<SelectedObject> sels_;
 };
 
+std::shared_ptr<FilterPatternBits>
+TriggerObjectTableProducer::globalBeginRun(edm::Run const& iRun, edm::EventSetup const& iSetup) const
+{
+    auto cache = std::make_shared<FilterPatternBits>();
+    HLTConfigProvider hltConfig;
+    bool changed = false;
+    if (!patterns_.empty() && hltConfig.init(iRun, iSetup, hltProcess_, changed)) {
+        for (unsigned int i = 0, n = hltConfig.size(); i < n; ++i) {
+            for (const std::string & label : hltConfig.moduleLabels(i)) {
+                if (cache->labelBits.count(label)) continue;
+                uint64_t bits = 0;
+                for (unsigned int ip = 0, np = patterns_.size(); ip < np; ++ip) {
+                    if (wildcardMatch(patterns_[ip].c_str(), label.c_str())) bits |= (uint64_t(1) << ip);
+                }
+                cache->labelBits.emplace(label, bits);
+            }
+        }
+    }
+    return cache;
+}
+
+bool
+TriggerObjectTableProducer::wildcardMatch(const char * pattern, const char * label)
+{
+    const char * star = nullptr, * retry = nullptr;
+    while (*label) {
+        if (*pattern == '*') { star = pattern++; retry = label; }
+        else if (*pattern == *label) { ++pattern; ++label; }
+        else if (star) { pattern = star+1; label = ++retry; }
+        else return false;
+    }
+    while (*pattern == '*') ++pattern;
+    return *pattern == 0;
+}
+
+uint64_t
+TriggerObjectTableProducer::patternBits(const FilterPatternBits & cache, const std::string & label) const
+{
+    auto match = cache.labelBits.find(label);
+    if (match != cache.labelBits.end()) return match->second;
+    // not in the menu (e.g. no HLT configuration available), so match it now
+    uint64_t bits = 0;
+    for (unsigned int ip = 0, np = patterns_.size(); ip < np; ++ip) {
+        if (wildcardMatch(patterns_[ip].c_str(), label.c_str())) bits |= (uint64_t(1) << ip);
+    }
+    return bits;
+}
+
 // ------------ method called to produce the data  ------------
 void
-TriggerObjectTableProducer::produce(edm::StreamID, edm::Event& iEvent, const edm::EventSetup& iSetup) const 
+TriggerObjectTableProducer::produce(edm::StreamID, edm::Event& iEvent, const edm::EventSetup& iSetup) const
 {
 
     edm::Handle<std::vector<pat::TriggerObjectStandAlone>> src;
     iEvent.getByToken(src_, src);
+    edm::Handle<edm::TriggerResults> triggerResults;
+    if (lazyUnpack_) iEvent.getByToken(triggerResults_, triggerResults);
+    const FilterPatternBits & cache = *runCache(iEvent.getRun().index());
+    unsigned int nsrc = src->size();
 
-    std::vector<std::pair<const pat::TriggerObjectStandAlone *, const SelectedObject *>> selected;
-    for (const auto & obj : *src) {
-        for (const auto & sel : sels_) {
-            if (sel.match(obj)) {
-                selected.emplace_back(&obj,&sel);
-                break;
+    // objects with their filter labels, unpacked only when needed, and the bitmask of the patterns they match
+    std::vector<std::unique_ptr<pat::TriggerObjectStandAlone>> unpacked(nsrc);
+    std::vector<uint64_t> bitsOf(nsrc, 0);
+    std::vector<bool> done(nsrc, false);
+    auto unpack = [&](unsigned int j) -> const pat::TriggerObjectStandAlone & {
+        if (!done[j]) {
+            done[j] = true;
+            const pat::TriggerObjectStandAlone * obj = &(*src)[j];
+            if (lazyUnpack_) {
+                unpacked[j].reset(new pat::TriggerObjectStandAlone(*obj));
+                unpacked[j]->unpackFilterLabels(iEvent, *triggerResults);
+                obj = unpacked[j].get();
             }
+            for (const std::string & label : obj->filterLabels()) bitsOf[j] |= patternBits(cache, label);
+        }
+        return lazyUnpack_ ? *unpacked[j] : (*src)[j];
+    };
+
+    // objects by trigger object type, so that each selection looks only at the objects of its type
+    std::map<int, std::vector<unsigned int>> byType;
+    std::vector<unsigned int> all(nsrc);
+    for (unsigned int j = 0; j < nsrc; ++j) {
+        all[j] = j;
+        for (int type : (*src)[j].filterIds()) {
+            auto & bucket = byType[type];
+            if (bucket.empty() || bucket.back() != j) bucket.push_back(j);
         }
     }
 
+    // each object goes to the first selection it passes
+    std::vector<const SelectedObject *> selOf(nsrc, nullptr);
+    for (const auto & sel : sels_) {
+        const std::vector<unsigned int> * candidates = &all;
+        if (!sel.cut) {
+            auto bucket = byType.find(sel.type);
+            if (bucket == byType.end()) continue;
+            candidates = &bucket->second;
+        }
+        for (unsigned int j : *candidates) {
+            if (selOf[j] || !sel.preselect((*src)[j])) continue;
+            const auto & obj = unpack(j);
+            if (sel.match(obj, bitsOf[j])) selOf[j] = &sel;
+        }
+    }
+    std::vector<std::pair<unsigned int, const SelectedObject *>> selected;
+    for (unsigned int j = 0; j < nsrc; ++j) {
+        if (selOf[j]) selected.emplace_back(j, selOf[j]);
+    }
+
+    // the seed searches below use the kinematics of all the trigger objects,
+    // and the seed cuts are evaluated once per object and not once per pair
+    edm::Handle<CandidateKinematics> kinHandle;
+    CandidateKinematics localKin;
+    const CandidateKinematics * kin = &localKin;
+    if (!kinematics_.isUninitialized()) {
+        iEvent.getByToken(kinematics_, kinHandle);
+        if (kinHandle->id() != src.id()) throw cms::Exception("Configuration") << "The kinematics of the trigger objects are not made from src\n";
+        if (kinHandle->size() != nsrc) throw cms::Exception("LogicError") << "The kinematics have " << kinHandle->size() << " entries for " << nsrc << " trigger objects\n";
+        kin = kinHandle.product();
+    } else {
+        localKin.fill(*src);
+    }
+    const std::vector<float> & srcPt = kin->pt(), & srcEta = kin->eta(), & srcPhi = kin->phi();
+    std::map<const SelectedObject *, std::pair<std::vector<bool>,std::vector<bool>>> seedMasks;
+    float maxSeedDR2 = 0;
+    for (const auto & p : selected) {
+        const SelectedObject * sel = p.second;
+        if ((sel->l1DR2 <= 0 && sel->l2DR2 <= 0) || seedMasks.count(sel)) continue;
+        auto & masks = seedMasks[sel];
+        if (sel->l1DR2 > 0) { masks.first.resize(src->size()); for (unsigned int j = 0, n = src->size(); j < n; ++j) masks.first[j] = sel->l1cut((*src)[j]); }
+        if (sel->l2DR2 > 0) { masks.second.resize(src->size()); for (unsigned int j = 0, n = src->size(); j < n; ++j) masks.second[j] = sel->l2cut((*src)[j]); }
+        maxSeedDR2 = std::max(maxSeedDR2, std::max(sel->l1DR2, sel->l2DR2));
+    }
+    // one grid for all the seed searches, with cells as large as the largest cone
+    std::unique_ptr<matching::EtaPhiGrid> seedGrid;
+    if (maxSeedDR2 > 0) seedGrid.reset(new matching::EtaPhiGrid(srcEta.data(), srcPhi.data(), nsrc, std::sqrt(maxSeedDR2)));
+
     unsigned int nobj = selected.size();
     std::vector<float> pt(nobj,0), eta(nobj,0), phi(nobj,0), l1pt(nobj, 0), l2pt(nobj, 0);
     std::vector<int>   id(nobj,0), bits(nobj, 0);
     for (unsigned int i = 0; i < nobj; ++i) {
-        const auto & obj = *selected[i].first;
+        unsigned int iobj = selected[i].first;
+        const auto & obj = unpack(iobj);
         const auto & sel = *selected[i].second;
-        pt[i] = obj.pt(); 
-        eta[i] = obj.eta(); 
-        phi[i] = obj.phi(); 
+        pt[i] = srcPt[iobj];
+        eta[i] = srcEta[iobj];
+        phi[i] = srcPhi[iobj];
         id[i] = sel.id;
-        bits[i] = sel.qualityBits(obj);
-        if (sel.l1DR2 > 0) {   
-            float best = sel.l1DR2;
-            for (const auto & seed : *src) {
-                float dr2 = deltaR2(seed, obj);
-                if (dr2 < best && sel.l1cut(seed)) {
-                    l2pt[i] = seed.pt();
-                }
-            }
+        bits[i] = sel.computeQualityBits(obj, bitsOf[iobj]);
+        if (sel.l1DR2 > 0) {
+            const std::vector<bool> & mask = seedMasks[&sel].first;
+            auto best = matching::bestMatch(eta[i], phi[i], *seedGrid, sel.l1DR2, [&mask](unsigned int j) { return mask[j]; });
+            if (best.first >= 0) l1pt[i] = srcPt[best.first];
         }
         if (sel.l2DR2 > 0) {
-            float best = sel.l2DR2;
-            for (const auto & seed : *src) {
-                float dr2 = deltaR2(seed, obj);
-                if (dr2 < best && sel.l2cut(seed)) {
-                    l2pt[i] = seed.pt();
-                }
-            }
+            const std::vector<bool> & mask = seedMasks[&sel].second;
+            auto best = matching::bestMatch(eta[i], phi[i], *seedGrid, sel.l2DR2, [&mask](unsigned int j) { return mask[j]; });
+            if (best.first >= 0) l2pt[i] = srcPt[best.first];
         }
     }
 
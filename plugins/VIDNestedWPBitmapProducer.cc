@@ -19,10 +19,11 @@
 
 // system include files
 #include <memory>
+#include <atomic>
 
 // user include files
 #include "FWCore/Framework/interface/Frameworkfwd.h"
-#include "FWCore/Framework/interface/stream/EDProducer.h"
+#include "FWCore/Framework/interface/global/EDProducer.h"
 
 #include "FWCore/Framework/interface/Event.h"
 #include "FWCore/Framework/interface/MakerMacros.h"
@@ -40,11 +41,10 @@
 //
 
 template <typename T>
-class VIDNestedWPBitmapProducer : public edm::stream::EDProducer<> {
+class VIDNestedWPBitmapProducer : public edm::global::EDProducer<> {
    public:
   explicit VIDNestedWPBitmapProducer(const edm::ParameterSet &iConfig):
-    src_(consumes<edm::View<T>>(iConfig.getParameter<edm::InputTag>("src"))),
-    isInit_(false)
+    src_(consumes<edm::View<T>>(iConfig.getParameter<edm::InputTag>("src")))
   {
     auto vwp = iConfig.getParameter<std::vector<std::string>>("WorkingPoints");
     for (auto wp : vwp) {
@@ -52,6 +52,8 @@ class VIDNestedWPBitmapProducer : public edm::stream::EDProducer<> {
       src_cutflows_.push_back(consumes<edm::ValueMap<vid::CutFlowResult> >(edm::InputTag(wp)));
     }
     nWP = src_bitmaps_.size();
+    nBits = ceil(log2(nWP+1));
+    nCuts_ = 0;
     produces<edm::ValueMap<int>>();
   }
   ~VIDNestedWPBitmapProducer() override {}
@@ -59,9 +61,7 @@ class VIDNestedWPBitmapProducer : public edm::stream::EDProducer<> {
       static void fillDescriptions(edm::ConfigurationDescriptions& descriptions);
 
    private:
-  void beginStream(edm::StreamID) override {};
-  void produce(edm::Event&, const edm::EventSetup&) override;
-  void endStream() override {};
+  void produce(edm::StreamID, edm::Event&, const edm::EventSetup&) const override;
 
       //virtual void beginRun(edm::Run const&, edm::EventSetup const&) override;
       //virtual void endRun(edm::Run const&, edm::EventSetup const&) override;
@@ -76,11 +76,39 @@ class VIDNestedWPBitmapProducer : public edm::stream::EDProducer<> {
 
   unsigned nWP;
   unsigned nBits;
-  unsigned nCuts;
-  std::vector<unsigned> res_;
-  bool isInit_;
-
-  void initNCuts(unsigned);
+  mutable std::atomic<unsigned> nCuts_; // set by the first event with objects, and then required to stay the same
+
+  void checkNCuts(unsigned) const;
+  /// move bit k of the input to bit nBits*k of the output
+  unsigned spreadBits(unsigned bitmap) const {
+    unsigned ret = 0;
+    for (; bitmap != 0; bitmap &= bitmap-1) ret |= 1u << (nBits * __builtin_ctz(bitmap));
+    return ret;
+  }
+  /// true if the objects of src are the objects of a single product, in their order (ref i has key i)
+  static bool isIdentity(const edm::View<T> & src) {
+    if (src.empty()) return true;
+    const edm::ProductID id = src.refAt(0).id();
+    for (uint i=0, n=src.size(); i<n; i++) {
+      auto ref = src.refAt(i);
+      if (ref.key() != i || ref.id() != id) return false;
+    }
+    return true;
+  }
+  /// copy the values of the map for all the objects in src into out; if src is identity (see isIdentity),
+  /// the values are copied by position from the range of its product in the map
+  static void fillBitmaps(const edm::View<T> & src, bool identity, const edm::ValueMap<unsigned> & map, unsigned * out) {
+    if (identity && !src.empty()) {
+      const edm::ProductID id = src.refAt(0).id();
+      for (auto it = map.begin(), end = map.end(); it != end; ++it) {
+        if (it.id() == id && it.size() >= src.size()) {
+          std::copy(it.begin(), it.begin() + src.size(), out);
+          return;
+        }
+      }
+    }
+    for (uint i=0, n=src.size(); i<n; i++) out[i] = map[src.ptrAt(i)];
+  }
 
 };
 
@@ -95,7 +123,7 @@ class VIDNestedWPBitmapProducer : public edm::stream::EDProducer<> {
 
 template <typename T>
 void
-VIDNestedWPBitmapProducer<T>::produce(edm::Event& iEvent, const edm::EventSetup& iSetup)
+VIDNestedWPBitmapProducer<T>::produce(edm::StreamID, edm::Event& iEvent, const edm::EventSetup& iSetup) const
 {
 
   edm::Handle<edm::View<T>> src;
@@ -105,28 +133,42 @@ VIDNestedWPBitmapProducer<T>::produce(edm::Event& iEvent, const edm::EventSetup&
   std::vector<edm::Handle<edm::ValueMap<vid::CutFlowResult>>> src_cutflows(nWP);
   for (uint i=0; i<nWP; i++) iEvent.getByToken(src_cutflows_[i], src_cutflows[i]);
 
-  std::vector<unsigned> res;
-
   auto npho = src->size();
-  for (uint i=0; i<npho; i++){
-    auto obj = src->ptrAt(i);
+  std::vector<int> res(npho, 0);
+  if (npho > 0) {
+    // the number of cuts is the same for all the objects, so it is read only from the first one (by reference, without copying the cutflow)
+    unsigned nCuts = 0;
+    auto first = src->ptrAt(0);
     for (uint j=0; j<nWP; j++){
-      auto cutflow = (*(src_cutflows[j]))[obj];
-      if (!isInit_) initNCuts(cutflow.cutFlowSize());
-      if (cutflow.cutFlowSize()!=nCuts) throw cms::Exception("Configuration","Trying to compress VID bitmaps for cutflows of different size");
-      auto bitmap = (*(src_bitmaps[j]))[obj];
-      for (uint k=0; k<nCuts; k++){
-	if (j==0) res_[k] = 0;
-	if (bitmap>>k & 1) {
-	  if (res_[k]!=j) throw cms::Exception("Configuration","Trying to compress VID bitmaps which are not nested in the correct order for all cuts");
-	  res_[k]++;
-	}
+      const vid::CutFlowResult & cutflow = (*(src_cutflows[j]))[first];
+      if (j == 0) nCuts = cutflow.cutFlowSize();
+      else if (cutflow.cutFlowSize()!=nCuts) throw cms::Exception("Configuration","Trying to compress VID bitmaps for cutflows of different size");
+    }
+    unsigned expected = 0;
+    if (!nCuts_.compare_exchange_strong(expected, nCuts) && expected != nCuts) {
+      throw cms::Exception("Configuration","Trying to compress VID bitmaps for cutflows of different size");
+    }
+    checkNCuts(nCuts);
+    const unsigned cutMask = (nCuts < 32 ? (1u << nCuts) : 0u) - 1;
+
+    // bitmaps of all the objects, one working point after the other
+    std::vector<unsigned> bitmaps(nWP*npho);
+    const bool identity = isIdentity(*src);
+    for (uint j=0; j<nWP; j++) fillBitmaps(*src, identity, *src_bitmaps[j], &bitmaps[j*npho]);
+
+    for (uint i=0; i<npho; i++){
+      // the number of working points passed by each cut is stored in a field of nBits bits.
+      // since the working points are nested, a cut passed by WP j is passed by all the ones before it,
+      // so the counts are obtained by adding up the bitmaps, after moving bit k to the first bit of field k
+      unsigned out = 0, prev = cutMask;
+      for (uint j=0; j<nWP; j++){
+        unsigned bitmap = bitmaps[j*npho+i] & cutMask;
+        if (bitmap & ~prev) throw cms::Exception("Configuration","Trying to compress VID bitmaps which are not nested in the correct order for all cuts");
+        out += spreadBits(bitmap);
+        prev = bitmap;
       }
+      res[i] = out;
     }
-
-    int out = 0;
-    for (uint k=0; k<nCuts; k++) out |= (res_[k] << (nBits*k));
-    res.push_back(out);
   }
 
 
@@ -141,12 +183,8 @@ VIDNestedWPBitmapProducer<T>::produce(edm::Event& iEvent, const edm::EventSetup&
 
 template <typename T>
 void
-VIDNestedWPBitmapProducer<T>::initNCuts(uint n){
-  nCuts = n;
-  nBits = ceil(log2(nWP+1));
+VIDNestedWPBitmapProducer<T>::checkNCuts(uint nCuts) const {
   if (nBits*nCuts>sizeof(int)*8) throw cms::Exception("Configuration","Integer cannot contain the compressed VID bitmap information");
-  res_.resize(nCuts,0);
-  isInit_ = true;
 }
 
 // ------------ method fills 'descriptions' with the allowed parameters for the module  ------------
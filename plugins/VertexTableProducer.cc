@@ -22,7 +22,7 @@
 
 // user include files
 #include "FWCore/Framework/interface/Frameworkfwd.h"
-#include "FWCore/Framework/interface/stream/EDProducer.h"
+#include "FWCore/Framework/interface/global/EDProducer.h"
 
 #include "FWCore/Framework/interface/Event.h"
 #include "FWCore/Framework/interface/MakerMacros.h"
@@ -36,16 +36,14 @@
 #include "CommonTools/Utils/interface/StringCutObjectSelector.h"
 
 #include "PhysicsTools/NanoAOD/interface/FlatTable.h"
-#include "RecoVertex/VertexTools/interface/VertexDistance3D.h"
-#include "RecoVertex/VertexPrimitives/interface/ConvertToFromReco.h"
-#include "RecoVertex/VertexPrimitives/interface/VertexState.h"
+#include "PhysicsTools/NanoAOD/interface/SVGeometry.h"
 #include "DataFormats/Common/interface/ValueMap.h"
 
 //
 // class declaration
 //
 
-class VertexTableProducer : public edm::stream::EDProducer<> {
+class VertexTableProducer : public edm::global::EDProducer<> {
    public:
       explicit VertexTableProducer(const edm::ParameterSet&);
       ~VertexTableProducer() override;
@@ -53,9 +51,7 @@ class VertexTableProducer : public edm::stream::EDProducer<> {
       static void fillDescriptions(edm::ConfigurationDescriptions& descriptions);
 
    private:
-      void beginStream(edm::StreamID) override;
-      void produce(edm::Event&, const edm::EventSetup&) override;
-      void endStream() override;
+      void produce(edm::StreamID, edm::Event&, const edm::EventSetup&) const override;
 
       //virtual void beginRun(edm::Run const&, edm::EventSetup const&) override;
       //virtual void endRun(edm::Run const&, edm::EventSetup const&) override;
@@ -67,6 +63,7 @@ class VertexTableProducer : public edm::stream::EDProducer<> {
       const edm::EDGetTokenT<std::vector<reco::Vertex>> pvs_;
       const edm::EDGetTokenT<edm::ValueMap<float>> pvsScore_;
       const edm::EDGetTokenT<edm::View<reco::VertexCompositePtrCandidate> > svs_;
+      const edm::EDGetTokenT<SVGeometry> svGeometry_;
       const StringCutObjectSelector<reco::Candidate> svCut_;
       const std::string  pvName_;
       const std::string  svName_;
@@ -84,6 +81,7 @@ VertexTableProducer::VertexTableProducer(const edm::ParameterSet& params):
     pvs_(consumes<std::vector<reco::Vertex>>( params.getParameter<edm::InputTag>("pvSrc") )),
     pvsScore_(consumes<edm::ValueMap<float>>( params.getParameter<edm::InputTag>("pvSrc") )),
     svs_(consumes<edm::View<reco::VertexCompositePtrCandidate> >( params.getParameter<edm::InputTag>("svSrc") )),
+    svGeometry_(consumes<SVGeometry>( params.getParameter<edm::InputTag>("svGeometry") )),
     svCut_(params.getParameter<std::string>("svCut") , true),
     pvName_(params.getParameter<std::string>("pvName") ),
     svName_(params.getParameter<std::string>("svName") ),
@@ -117,7 +115,7 @@ VertexTableProducer::~VertexTableProducer()
 
 
 void
-VertexTableProducer::produce(edm::Event& iEvent, const edm::EventSetup& iSetup)
+VertexTableProducer::produce(edm::StreamID, edm::Event& iEvent, const edm::EventSetup& iSetup) const
 {
     using namespace edm;
     edm::Handle<edm::ValueMap<float>> pvsScoreIn;
@@ -141,17 +139,19 @@ VertexTableProducer::produce(edm::Event& iEvent, const edm::EventSetup& iSetup)
 
     edm::Handle<edm::View<reco::VertexCompositePtrCandidate> > svsIn;
     iEvent.getByToken(svs_, svsIn);
+    edm::Handle<SVGeometry> svGeometry;
+    iEvent.getByToken(svGeometry_, svGeometry);
+    if (svGeometry->id() != svsIn.id()) throw cms::Exception("Configuration", "svGeometry is not made from svSrc\n");
     auto selCandSv = std::make_unique<PtrVector<reco::Candidate>>();
     std::vector<float> dlen,dlenSig;
-    VertexDistance3D vdist;
 
     size_t i=0;
     for (const auto & sv : *svsIn) {
        if (svCut_(sv)) {
-           Measurement1D dl= vdist.distance((*pvsIn)[0],VertexState(RecoVertex::convertPos(sv.position()),RecoVertex::convertError(sv.error())));
-	   if(dl.value() > dlenMin_ and dl.significance() > dlenSigMin_){
-                dlen.push_back(dl.value());	
-                dlenSig.push_back(dl.significance());	
+	   double dl = svGeometry->dist()[i], dlSig = svGeometry->distSig()[i];
+	   if(dl > dlenMin_ and dlSig > dlenSigMin_){
+                dlen.push_back(dl);	
+                dlenSig.push_back(dlSig);	
 	 	edm::Ptr<reco::Candidate> c =  svsIn->ptrAt(i);
 		selCandSv->push_back(c);
 	   }
@@ -172,17 +172,6 @@ VertexTableProducer::produce(edm::Event& iEvent, const edm::EventSetup& iSetup)
     iEvent.put(std::move(selCandSv));
 }
 
-// ------------ method called once each stream before processing any runs, lumis or events  ------------
-void
-VertexTableProducer::beginStream(edm::StreamID)
-{
-}
-
-// ------------ method called once each stream after processing all runs, lumis and events  ------------
-void
-VertexTableProducer::endStream() {
-}
-
 // ------------ method fills 'descriptions' with the allowed parameters for the module  ------------
 void
 VertexTableProducer::fillDescriptions(edm::ConfigurationDescriptions& descriptions) {
@@ -4,6 +4,7 @@ NanoAODEDMEventContent = cms.PSet(
     outputCommands = cms.untracked.vstring(
         'drop *',
         "keep FlatTable_*Table_*_*",     # event data
+        "keep FlatTable_linkedObjects_*_*", # index links between the objects
         "keep edmTriggerResults_*_*_*",  # event data
         "keep MergableCounterTable_*Table_*_*", # accumulated per/run or per/lumi data
         "keep UniqueString_nanoMetadata_*_*",   # basic metadata
@@ -43,10 +43,18 @@ isoForEle = cms.EDProducer("EleIsoValueMapProducer",
     EAFile_PFIso = cms.FileInPath("RecoEgamma/ElectronIdentification/data/Summer16/effAreaElectrons_cone03_pfNeuHadronsAndPhotons_80X.txt"),
 )
 
+trackQualityForEle = cms.EDProducer("PackedCandidateTrackQualityProducer",
+    src = cms.InputTag("packedPFCandidates"),
+    pvSrc = cms.InputTag("offlineSlimmedPrimaryVertices"),
+    srcJet = cms.InputTag("slimmedJets"),
+    srcLep = cms.InputTag("slimmedElectrons"),
+)
+
 ptRatioRelForEle = cms.EDProducer("ElectronJetVarProducer",
     srcJet = cms.InputTag("slimmedJets"),
     srcLep = cms.InputTag("slimmedElectrons"),
     srcVtx = cms.InputTag("offlineSlimmedPrimaryVertices"),
+    trackQuality = cms.InputTag("trackQualityForEle"),
 )
 
 from EgammaAnalysis.ElectronTools.calibratedElectronsRun2_cfi import calibratedPatElectrons
@@ -95,7 +103,7 @@ slimmedElectronsWithUserData = cms.EDProducer("PATElectronUserDataEmbedder",
 )
 
 electronMVATTH= cms.EDProducer("EleBaseMVAValueMapProducer",
-    src = cms.InputTag("linkedObjects","electrons"),
+    src = cms.InputTag("finalElectrons"),
     weightFile =  cms.FileInPath("PhysicsTools/NanoAOD/data/el_BDTG.weights.xml"),
     name = cms.string("electronMVATTH"),
     isClassifier = cms.bool(True),
@@ -117,15 +125,13 @@ electronMVATTH= cms.EDProducer("EleBaseMVAValueMapProducer",
 )
 
 electronTable = cms.EDProducer("SimpleCandidateFlatTableProducer",
-    src = cms.InputTag("linkedObjects","electrons"),
+    src = cms.InputTag("finalElectrons"),
     cut = cms.string(""), #we should not filter on cross linked collections
     name= cms.string("Electron"),
     doc = cms.string("slimmedElectrons after basic selection (" + finalElectrons.cut.value()+")"),
     singleton = cms.bool(False), # the number of entries is variable
     extension = cms.bool(False), # this is the main table for the electrons
     variables = cms.PSet(CandVars,
-        jetIdx = Var("?hasUserCand('jet')?userCand('jet').key():-1", int, doc="index of the associated jet (-1 if none)"),
-        photonIdx = Var("?overlaps('photons').size()>0?overlaps('photons')[0].key():-1", int, doc="index of the associated photon (-1 if none)"),
         #ptErr = Var("gsfTrack().ptError()",float,doc="pt error of the GSF track",precision=6),
         energyErr = Var("p4Error('P4_COMBINATION')*userFloat('eCorr')",float,doc="energy error of the cluster-track combination",precision=6),
         eCorr = Var("userFloat('eCorr')",float,doc="ratio of the calibrated energy/miniaod energy"),
@@ -180,8 +186,9 @@ electronMCTable = cms.EDProducer("CandMCMatchTableProducer",
     objType = electronTable.name, #cms.string("Electron"),
     branchName = cms.string("mcMatch"),
     docString = cms.string("MC matching to status==1 electrons or photons"),
+    genHistory = cms.InputTag("genHistory"),
 )
 
-electronSequence = cms.Sequence(egmGsfElectronIDSequence + bitmapVIDForEle + isoForEle + ptRatioRelForEle + calibratedPatElectrons + energyCorrForEle + slimmedElectronsWithUserData + finalElectrons)
+electronSequence = cms.Sequence(egmGsfElectronIDSequence + bitmapVIDForEle + isoForEle + trackQualityForEle + ptRatioRelForEle + calibratedPatElectrons + energyCorrForEle + slimmedElectronsWithUserData + finalElectrons)
 electronTables = cms.Sequence (electronMVATTH + electronTable)
 electronMC = cms.Sequence(electronsMCMatchForTable + electronMCTable)
@@ -64,6 +64,10 @@ genParticleTable = cms.EDProducer("SimpleCandidateFlatTableProducer",
     )
 )
 
-genParticleSequence = cms.Sequence(finalGenParticles)
+genHistory = cms.EDProducer("GenHistoryProducer",
+    src = cms.InputTag("finalGenParticles"),
+)
+
+genParticleSequence = cms.Sequence(finalGenParticles + genHistory)
 genParticleTables = cms.Sequence(genParticleTable)
 
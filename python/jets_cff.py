@@ -9,36 +9,9 @@ from RecoJets.JetProducers.ak4PFJets_cfi import ak4PFJets
 chsForSATkJets = cms.EDFilter("CandPtrSelector", src = cms.InputTag("packedPFCandidates"), cut = cms.string('charge()!=0 && pvAssociationQuality()>=5 && vertexRef().key()==0'))
 #chsForSATkJets = cms.EDFilter("CandPtrSelector", src = cms.InputTag("packedPFCandidates"), cut = cms.string('charge()!=0 && fromPV && vertexRef().key()==0'))
 softActivityJets = ak4PFJets.clone(src = 'chsForSATkJets', doAreaFastjet = False, jetPtMin=1) 
-softActivityJets10 = cms.EDFilter("CandPtrSelector", src = cms.InputTag("chsForSATkJets"), cut = cms.string('pt>10'))
-softActivityJets5 = cms.EDFilter("CandPtrSelector", src = cms.InputTag("chsForSATkJets"), cut = cms.string('pt>5'))
-softActivityJets2 = cms.EDFilter("CandPtrSelector", src = cms.InputTag("chsForSATkJets"), cut = cms.string('pt>2'))
-
-looseJetId = cms.EDProducer("PatJetIDValueMapProducer",
-			  filterParams=cms.PSet(
-			    version = cms.string('WINTER16'),
-			    quality = cms.string('LOOSE'),
-			  ),
-                          src = cms.InputTag("slimmedJets")
-)
-tightJetId = cms.EDProducer("PatJetIDValueMapProducer",
-			  filterParams=cms.PSet(
-			    version = cms.string('WINTER16'),
-			    quality = cms.string('TIGHT'),
-			  ),
-                          src = cms.InputTag("slimmedJets")
-)
-
-slimmedJetsWithUserData = cms.EDProducer("PATJetUserDataEmbedder",
-     src = cms.InputTag("slimmedJets"),
-     userInts = cms.PSet(
-        tightId = cms.InputTag("tightJetId"),
-        looseId = cms.InputTag("looseJetId"),
-     ),
-)
-
 
 finalJets = cms.EDFilter("PATJetRefSelector",
-    src = cms.InputTag("slimmedJetsWithUserData"),
+    src = cms.InputTag("slimmedJets"),
     cut = cms.string("pt > 15")
 )
 
@@ -50,7 +23,7 @@ finalJets = cms.EDFilter("PATJetRefSelector",
 
 
 jetTable = cms.EDProducer("SimpleCandidateFlatTableProducer",
-    src = cms.InputTag("linkedObjects","jets"),
+    src = cms.InputTag("finalJets"),
     cut = cms.string(""), #we should not filter on cross linked collections
     name = cms.string("Jet"),
     doc  = cms.string("slimmedJets, i.e. ak4 PFJets CHS with JECs applied, after basic selection (" + finalJets.cut.value()+")"),
@@ -61,19 +34,12 @@ jetTable = cms.EDProducer("SimpleCandidateFlatTableProducer",
     ),
     variables = cms.PSet(P4Vars,
         area = Var("jetArea()", float, doc="jet catchment area, for JECs",precision=10),
-        nMuons = Var("?hasOverlaps('muons')?overlaps('muons').size():0", int, doc="number of muons in the jet"),
-        muonIdx1 = Var("?overlaps('muons').size()>0?overlaps('muons')[0].key():-1", int, doc="index of first matching muon"),
-        muonIdx2 = Var("?overlaps('muons').size()>1?overlaps('muons')[1].key():-1", int, doc="index of second matching muon"),
-        electronIdx1 = Var("?overlaps('electrons').size()>0?overlaps('electrons')[0].key():-1", int, doc="index of first matching electron"),
-        electronIdx2 = Var("?overlaps('electrons').size()>1?overlaps('electrons')[1].key():-1", int, doc="index of second matching electron"),
-        nElectrons = Var("?hasOverlaps('electrons')?overlaps('electrons').size():0", int, doc="number of electrons in the jet"),
 	btagCMVA = Var("bDiscriminator('pfCombinedMVAV2BJetTags')",float,doc="CMVA V2 btag discriminator",precision=10),
 	btagDeepB = Var("bDiscriminator('pfDeepCSVJetTags:probb')",float,doc="CMVA V2 btag discriminator",precision=10),
 	btagDeepBB = Var("bDiscriminator('pfDeepCSVJetTags:probbb')",float,doc="CMVA V2 btag discriminator",precision=10),
 	btagDeepC = Var("bDiscriminator('pfDeepCSVJetTags:probc')",float,doc="CMVA V2 btag discriminator",precision=10),
 #puIdDisc = Var("userFloat('pileupJetId:fullDiscriminant')",float,doc="Pilup ID discriminant",precision=10),
 	puId = Var("userInt('pileupJetId:fullId')",int,doc="Pilup ID flags"),
-	jetId = Var("userInt('tightId')*2+userInt('looseId')",int,doc="Jet ID flags bit1 is loose, bit2 is tight"),
 	qgl = Var("userFloat('QGTagger:qgLikelihood')",float,doc="Quark vs Gluon likelihood discriminator",precision=10),
 	nConstituents = Var("numberOfDaughters()",int,doc="Number of particles in the jet"),
 	rawFactor = Var("1.-jecFactor('Uncorrected')",float,doc="1 - Factor to get back to raw pT",precision=6),
@@ -87,11 +53,31 @@ jetTable = cms.EDProducer("SimpleCandidateFlatTableProducer",
 #jets are not as precise as muons
 jetTable.variables.pt.precision=10
 
+# jet IDs are computed directly on the final jets and stored as an extension of the jet table
+jetIdTable = cms.EDProducer("PatJetIDValueMapProducer",
+			  filterParams=cms.PSet(
+			    version = cms.string('WINTER16'),
+			    quality = cms.string('LOOSE'),
+			  ),
+			  extraFilterParams=cms.VPSet(cms.PSet(
+			    version = cms.string('WINTER16'),
+			    quality = cms.string('TIGHT'),
+			  )),
+                          src = cms.InputTag("finalJets"),
+                          name = cms.string("Jet"),
+                          column = cms.string("jetId"),
+                          doc = cms.string("Jet ID flags bit1 is loose, bit2 is tight"),
+)
+
 
 bjetMVA= cms.EDProducer("BJetEnergyRegressionMVA",
-    src = cms.InputTag("linkedObjects","jets"),
+    src = cms.InputTag("finalJets"),
     pvsrc = cms.InputTag("offlineSlimmedPrimaryVertices"),
-    svsrc = cms.InputTag("slimmedSecondaryVertices"),
+    svGeometry = cms.InputTag("svGeometry"),
+    # the lepton variables (Jet_leptonPt, Jet_leptonDeltaR, Jet_leptonPtRel) use the links of the jets to the leptons
+    jetLinks = cms.InputTag("linkedObjects","jets"),
+    muons = cms.InputTag("finalMuons"),
+    electrons = cms.InputTag("finalElectrons"),
     weightFile =  cms.FileInPath("PhysicsTools/NanoAOD/data/bjet-regression.xml"),
     name = cms.string("JetReg"),
     isClassifier = cms.bool(False),
@@ -100,12 +86,8 @@ bjetMVA= cms.EDProducer("BJetEnergyRegressionMVA",
 	Jet_pt = cms.string("pt"),
 	Jet_eta = cms.string("eta"),
 	Jet_mt = cms.string("mt"),
-	Jet_leptonPt = cms.string("?overlaps('muons').size()>0?overlaps('muons')[0].pt():(?overlaps('electrons').size()>0?overlaps('electrons')[0].pt():0)"),
 	Jet_neHEF = cms.string("neutralHadronEnergy()/energy()"),
 	Jet_neEmEF = cms.string("neutralEmEnergy()/energy()"),
-	Jet_leptonDeltaR = cms.string('''?overlaps('muons').size()>0?deltaR(eta,phi,overlaps('muons')[0].eta,overlaps('muons')[0].phi):
-				(?overlaps('electrons').size()>0?deltaR(eta,phi,overlaps('electrons')[0].eta,overlaps('electrons')[0].phi):
-				0)'''),
     )
 
 )
@@ -115,6 +97,7 @@ saJetTable = cms.EDProducer("SimpleCandidateFlatTableProducer",
     src = cms.InputTag("softActivityJets"),
     cut = cms.string(""),
     maxLen = cms.uint32(6),
+    sortBy = cms.string("pt"), # keep the 6 leading jets
     name = cms.string("SoftActivityJet"),
     doc  = cms.string("jets clustered from charged candidates compatible with primary vertex (" + chsForSATkJets.cut.value()+")"),
     singleton = cms.bool(False), # the number of entries is variable
@@ -130,12 +113,13 @@ saJetTable.variables.phi.precision=8
 saTable = cms.EDProducer("GlobalVariablesTableProducer",
     variables = cms.PSet(
         SoftActivityJetHT = ExtVar( cms.InputTag("softActivityJets"), "candidatescalarsum", doc = "scalar sum of soft activity jet pt, pt>1" ),
-        SoftActivityJetHT10 = ExtVar( cms.InputTag("softActivityJets10"), "candidatescalarsum", doc = "scalar sum of soft activity jet pt , pt >10"  ),
-        SoftActivityJetHT5 = ExtVar( cms.InputTag("softActivityJets5"), "candidatescalarsum", doc = "scalar sum of soft activity jet pt, pt>5"  ),
-        SoftActivityJetHT2 = ExtVar( cms.InputTag("softActivityJets2"), "candidatescalarsum", doc = "scalar sum of soft activity jet pt, pt >2"  ),
-        SoftActivityJetNjets10 = ExtVar( cms.InputTag("softActivityJets10"), "candidatesize", doc = "number of soft activity jet pt, pt >2"  ),
-        SoftActivityJetNjets5 = ExtVar( cms.InputTag("softActivityJets5"), "candidatesize", doc = "number of soft activity jet pt, pt >5"  ),
-        SoftActivityJetNjets2 = ExtVar( cms.InputTag("softActivityJets2"), "candidatesize", doc = "number of soft activity jet pt, pt >10"  ),
+        # all the variables below are computed in a single pass over chsForSATkJets
+        SoftActivityJetHT10 = ExtVar( cms.InputTag("chsForSATkJets"), "candidatescalarsum", doc = "scalar sum of soft activity jet pt , pt >10"  ).clone(cut = cms.string("pt>10")),
+        SoftActivityJetHT5 = ExtVar( cms.InputTag("chsForSATkJets"), "candidatescalarsum", doc = "scalar sum of soft activity jet pt, pt>5"  ).clone(cut = cms.string("pt>5")),
+        SoftActivityJetHT2 = ExtVar( cms.InputTag("chsForSATkJets"), "candidatescalarsum", doc = "scalar sum of soft activity jet pt, pt >2"  ).clone(cut = cms.string("pt>2")),
+        SoftActivityJetNjets10 = ExtVar( cms.InputTag("chsForSATkJets"), "candidatesize", doc = "number of soft activity jet pt, pt >2"  ).clone(cut = cms.string("pt>10")),
+        SoftActivityJetNjets5 = ExtVar( cms.InputTag("chsForSATkJets"), "candidatesize", doc = "number of soft activity jet pt, pt >5"  ).clone(cut = cms.string("pt>5")),
+        SoftActivityJetNjets2 = ExtVar( cms.InputTag("chsForSATkJets"), "candidatesize", doc = "number of soft activity jet pt, pt >10"  ).clone(cut = cms.string("pt>2")),
 
     )
 )
@@ -202,7 +186,7 @@ fatJetTable.variables.pt.precision=10
 
 ## MC STUFF ######################
 jetMCTable = cms.EDProducer("SimpleCandidateFlatTableProducer",
-    src = cms.InputTag("linkedObjects","jets"),
+    src = cms.InputTag("finalJets"),
     cut = cms.string(""), #we should not filter on cross linked collections
     name = cms.string("Jet"),
     singleton = cms.bool(False), # the number of entries is variable
@@ -228,9 +212,9 @@ genJetTable = cms.EDProducer("SimpleCandidateFlatTableProducer",
 
 
 #before cross linking
-jetSequence = cms.Sequence(looseJetId+tightJetId+slimmedJetsWithUserData+chsForSATkJets+softActivityJets+softActivityJets2+softActivityJets5+softActivityJets10+finalJets)
+jetSequence = cms.Sequence(chsForSATkJets+softActivityJets+finalJets)
 #after cross linkining
-jetTables = cms.Sequence(bjetMVA+ jetTable+fatJetTable+subJetTable+saJetTable+saTable)
+jetTables = cms.Sequence(bjetMVA+ jetTable+jetIdTable+fatJetTable+subJetTable+saJetTable+saTable)
 
 #MC only producers and tables
 jetMC = cms.Sequence(jetMCTable+genJetTable)
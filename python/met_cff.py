@@ -8,7 +8,7 @@ from  PhysicsTools.NanoAOD.common_cff import *
 
 
 ##################### Tables for final output and docs ##########################
-metTable = cms.EDProducer("SimpleCandidateFlatTableProducer",
+metTable = cms.EDProducer("SimpleCandidateFlatTableGroupProducer",
     src = cms.InputTag("slimmedMETs"),
     name = cms.string("MET"),
     doc = cms.string("slimmedMET, type-1 corrected PF MET"),
@@ -23,18 +23,19 @@ metTable = cms.EDProducer("SimpleCandidateFlatTableProducer",
        significance = Var("metSignificance()", float, doc="MET significance",precision=10),
 
     ),
-)
-
-caloMetTable = cms.EDProducer("SimpleCandidateFlatTableProducer",
-    src = metTable.src,
-    name = cms.string("METCalo"),
-    doc = cms.string("Calo MET"),
-    singleton = cms.bool(True),  # there's always exactly one MET per event
-    extension = cms.bool(False), # this is the main table for the MET
-    variables = cms.PSet(#NOTA BENE: we don't copy PTVars here!
-       pt  = Var("caloMETPt",  float, precision=10),
-       phi = Var("caloMETPhi", float, precision=10),
-       sumEt = Var("caloMETSumEt", float, doc="scalar sum of Et", precision=10),
+    # other tables read from the same MET object, filled by this same module
+    tables = cms.VPSet(
+        cms.PSet(
+            label = cms.string("calo"),
+            name = cms.string("METCalo"),
+            doc = cms.string("Calo MET"),
+            extension = cms.bool(False), # this is the main table for the MET
+            variables = cms.PSet(#NOTA BENE: we don't copy PTVars here!
+               pt  = Var("caloMETPt",  float, precision=10),
+               phi = Var("caloMETPhi", float, precision=10),
+               sumEt = Var("caloMETSumEt", float, doc="scalar sum of Et", precision=10),
+            ),
+        ),
     ),
 )
 
@@ -62,6 +63,6 @@ metMCTable = cms.EDProducer("SimpleCandidateFlatTableProducer",
 )
 
 #metSequence = cms.Sequence()
-metTables = cms.Sequence( metTable + caloMetTable + puppiMetTable )
+metTables = cms.Sequence( metTable + puppiMetTable )
 metMC = cms.Sequence( metMCTable )
 
@@ -7,10 +7,18 @@ isoForMu = cms.EDProducer("MuonIsoValueMapProducer",
     EAFile_MiniIso = cms.FileInPath("PhysicsTools/NanoAOD/data/effAreaMuons_cone03_pfNeuHadronsAndPhotons_80X.txt"),
 )
 
+trackQualityForMu = cms.EDProducer("PackedCandidateTrackQualityProducer",
+    src = cms.InputTag("packedPFCandidates"),
+    pvSrc = cms.InputTag("offlineSlimmedPrimaryVertices"),
+    srcJet = cms.InputTag("slimmedJets"),
+    srcLep = cms.InputTag("slimmedMuons"),
+)
+
 ptRatioRelForMu = cms.EDProducer("MuonJetVarProducer",
     srcJet = cms.InputTag("slimmedJets"),
     srcLep = cms.InputTag("slimmedMuons"),
     srcVtx = cms.InputTag("offlineSlimmedPrimaryVertices"),
+    trackQuality = cms.InputTag("trackQualityForMu"),
 )
 
 slimmedMuonsWithUserData = cms.EDProducer("PATMuonUserDataEmbedder",
@@ -33,7 +41,7 @@ finalMuons = cms.EDFilter("PATMuonRefSelector",
 )
 
 muonMVATTH= cms.EDProducer("MuonBaseMVAValueMapProducer",
-    src = cms.InputTag("linkedObjects","muons"),
+    src = cms.InputTag("finalMuons"),
     weightFile =  cms.FileInPath("PhysicsTools/NanoAOD/data/mu_BDTG.weights.xml"),
     name = cms.string("muonMVATTH"),
     isClassifier = cms.bool(True),
@@ -55,7 +63,7 @@ muonMVATTH= cms.EDProducer("MuonBaseMVAValueMapProducer",
 )
 
 muonTable = cms.EDProducer("SimpleCandidateFlatTableProducer",
-    src = cms.InputTag("linkedObjects","muons"),
+    src = cms.InputTag("finalMuons"),
     cut = cms.string(""), #we should not filter on cross linked collections
     name = cms.string("Muon"),
     doc  = cms.string("slimmedMuons after basic selection (" + finalMuons.cut.value()+")"),
@@ -71,7 +79,6 @@ muonTable = cms.EDProducer("SimpleCandidateFlatTableProducer",
         sip3d = Var("abs(dB('PV3D')/edB('PV3D'))",float,doc="3D impact parameter significance wrt first PV",precision=10),
         segmentComp   = Var("segmentCompatibility()", float, doc = "muon segment compatibility", precision=14), # keep higher precision since people have cuts with 3 digits on this
         nStations = Var("numberOfMatchedStations", int, doc = "number of matched stations with default arbitration (segment & track)"),
-        jetIdx = Var("?hasUserCand('jet')?userCand('jet').key():-1", int, doc="index of the associated jet (-1 if none)"),
         miniPFIso_chg = Var("userFloat('miniIsoChg')",float,doc="mini PF isolation, charged component"),
         miniPFIso_all = Var("userFloat('miniIsoAll')",float,doc="mini PF isolation, total (with scaled rho*EA PU corrections)"),
         PFIso03_chg = Var("pfIsolationR03().sumChargedHadronPt",float,doc="PF isolation dR=0.3, charged component"),
@@ -109,9 +116,10 @@ muonMCTable = cms.EDProducer("CandMCMatchTableProducer",
     objType = muonTable.name, #cms.string("Muon"),
     branchName = cms.string("mcMatch"),
     docString = cms.string("MC matching to status==1 muons"),
+    genHistory = cms.InputTag("genHistory"),
 )
 
-muonSequence = cms.Sequence(isoForMu + ptRatioRelForMu + slimmedMuonsWithUserData + finalMuons)
+muonSequence = cms.Sequence(isoForMu + trackQualityForMu + ptRatioRelForMu + slimmedMuonsWithUserData + finalMuons)
 muonMC = cms.Sequence(muonsMCMatchForTable + muonMCTable)
 muonTables = cms.Sequence(muonMVATTH + muonTable + muonIDTable)
 
@@ -26,16 +26,22 @@ linkedObjects = cms.EDProducer("PATObjectCrossLinker",
    electrons=cms.InputTag("finalElectrons"),
    taus=cms.InputTag("finalTaus"),
    photons=cms.InputTag("finalPhotons"),
+   linkTables=cms.bool(True), # index links between the tables, as extension tables
+   copyCollections=cms.bool(False), # the tables and the MVAs read the links from the link tables
+   jetName=cms.string("Jet"),muonName=cms.string("Muon"),electronName=cms.string("Electron"),
+   tauName=cms.string("Tau"),photonName=cms.string("Photon")
 )
 
 simpleCleanerTable = cms.EDProducer("NanoAODSimpleCrossCleaner",
    name=cms.string("cleanmask"),
    doc=cms.string("simple cleaning mask with priority to leptons"),
-   jets=cms.InputTag("linkedObjects","jets"),
-   muons=cms.InputTag("linkedObjects","muons"),
-   electrons=cms.InputTag("linkedObjects","electrons"),
-   taus=cms.InputTag("linkedObjects","taus"),
-   photons=cms.InputTag("linkedObjects","photons"),
+   jets=cms.InputTag("finalJets"),
+   muons=cms.InputTag("finalMuons"),
+   electrons=cms.InputTag("finalElectrons"),
+   taus=cms.InputTag("finalTaus"),
+   photons=cms.InputTag("finalPhotons"),
+   muonLinks=cms.InputTag("linkedObjects","muons"), # jet of each muon
+   electronLinks=cms.InputTag("linkedObjects","electrons"), # jet of each electron
    jetSel=cms.string("pt>15"),
    muonSel=cms.string("isPFMuon && innerTrack.validFraction >= 0.49 && ( isGlobalMuon && globalTrack.normalizedChi2 < 3 && combinedQuality.chi2LocalPosition < 12 && combinedQuality.trkKink < 20 && segmentCompatibility >= 0.303 || segmentCompatibility >= 0.451 )"),
    electronSel=cms.string(""),
@@ -25,7 +25,7 @@ def _tauId6WPMask(pattern,doc):
 
 
 tauTable = cms.EDProducer("SimpleCandidateFlatTableProducer",
-    src = cms.InputTag("linkedObjects","taus"),
+    src = cms.InputTag("finalTaus"),
     cut = cms.string(""), #we should not filter on cross linked collections
     name= cms.string("Tau"),
     doc = cms.string("slimmedTaus after basic selection (" + finalTaus.cut.value()+")"),
@@ -33,7 +33,6 @@ tauTable = cms.EDProducer("SimpleCandidateFlatTableProducer",
     extension = cms.bool(False), # this is the main table for the taus
     variables = cms.PSet(P4Vars,
        charge = Var("charge", int, doc="electric charge"),                  
-       jetIdx = Var("?hasUserCand('jet')?userCand('jet').key():-1", int, doc="index of the associated jet (-1 if none)"),
        decayMode = Var("decayMode()",int),
        idDecayMode = Var("tauID('decayModeFinding')", bool),
        idDecayModeNewDMs = Var("tauID('decayModeFindingNewDMs')", bool),
@@ -78,7 +77,8 @@ tauGenJets.includeNeutrinos = cms.bool(False)
 
 genVisTaus = cms.EDProducer("GenVisTauProducer",
     src = cms.InputTag("tauGenJetsSelectorAllHadrons"),         
-    srcGenParticles = cms.InputTag("prunedGenParticles")
+    srcGenParticles = cms.InputTag("finalGenParticles"), # keeps the taus with their decays, and the mother index is the one of the GenPart table
+    genHistory = cms.InputTag("genHistory"), # made from the same finalGenParticles
 )
 
 genVisTauTable = cms.EDProducer("SimpleCandidateFlatTableProducer",
@@ -132,7 +132,6 @@ tauMCTable = cms.EDProducer("CandMCMatchTableProducer",
     docString = cms.string("MC matching to status==2 taus"),
 )
 
-
 tauSequence = cms.Sequence(finalTaus)
 tauTables = cms.Sequence(tauTable)
 tauMC = cms.Sequence(tauGenJets + tauGenJetsSelectorAllHadrons + genVisTaus + genVisTauTable + tausMCMatchLepTauForTable + tausMCMatchHadTauForTable + tauMCTable)
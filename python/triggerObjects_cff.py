@@ -1,82 +1,91 @@
 import FWCore.ParameterSet.Config as cms
 
-unpackedPatTrigger = cms.EDProducer("PATTriggerObjectStandAloneUnpacker",
-    patTriggerObjectsStandAlone = cms.InputTag('slimmedPatTrigger'),
-    triggerResults              = cms.InputTag('TriggerResults::HLT'),
-    unpackFilterLabels = cms.bool(True)
-)
-
 triggerObjectTable = cms.EDProducer("TriggerObjectTableProducer",
     name= cms.string("TrigObj"),
-    src = cms.InputTag("unpackedPatTrigger"),
+    src = cms.InputTag("slimmedPatTrigger"),
+    hltProcess = cms.string("HLT"), # HLT menu, and TriggerResults used to unpack the filter labels
+    unpackFilterLabels = cms.bool(True), # filter labels are unpacked only for the preselected objects; False if src is not packed
+    kinematics = cms.InputTag("triggerObjectKinematics"), # pt, eta and phi of all the objects of src, for the seed searches
     selections = cms.VPSet(
         cms.PSet(
             name = cms.string("Electron (PixelMatched e/gamma)"), # this selects also photons for the moment!
             id = cms.int32(11),
-            sel = cms.string("type(92) && pt > 7 && coll('hltEgammaCandidates') && filter('*PixelMatchFilter')"), 
+            type = cms.int32(92), ptMin = cms.double(7), coll = cms.string("hltEgammaCandidates"),
+            filters = cms.vstring("*PixelMatchFilter"), vetoFilters = cms.vstring(),
             l1seed = cms.string("type(-98) && coll('hltGtStage2Digis:EGamma')"),  l1deltaR = cms.double(0.3),
             #l2seed = cms.string("type(92) && coll('')"),  l2deltaR = cms.double(0.5),
-            qualityBits = cms.string("filter('*CaloIdLTrackIdLIsoVL*TrackIso*Filter') + 2*filter('hltEle*WPTight*TrackIsoFilter') + 4*filter('hltEle*WPLoose*TrackIsoFilter')"), 
+            qualityBitsFilters = cms.vstring("*CaloIdLTrackIdLIsoVL*TrackIso*Filter", "hltEle*WPTight*TrackIsoFilter", "hltEle*WPLoose*TrackIsoFilter"),
             qualityBitsDoc = cms.string("1 = CaloIdL_TrackIdL_IsoVL, 2 = WPLoose, 4 = WPTight"),
         ),
         cms.PSet(
             name = cms.string("Photon (PixelMatch-vetoed e/gamma)"), 
             id = cms.int32(22),
-            sel = cms.string("type(92) && pt > 20 && coll('hltEgammaCandidates') && !filter('*PixelMatchFilter')"), 
+            type = cms.int32(92), ptMin = cms.double(20), coll = cms.string("hltEgammaCandidates"),
+            filters = cms.vstring(), vetoFilters = cms.vstring("*PixelMatchFilter"),
             l1seed = cms.string("type(-98) && coll('hltGtStage2Digis:EGamma')"),  l1deltaR = cms.double(0.3),
             #l2seed = cms.string("type(92) && coll('')"),  l2deltaR = cms.double(0.5),
-            qualityBits = cms.string("0"), qualityBitsDoc = cms.string(""),
+            qualityBitsFilters = cms.vstring(), qualityBitsDoc = cms.string(""),
         ),
         cms.PSet(
             name = cms.string("Muon"),
             id = cms.int32(13),
-            sel = cms.string("type(83) && pt > 5 && coll('hltIterL3MuonCandidates')"), 
+            type = cms.int32(83), ptMin = cms.double(5), coll = cms.string("hltIterL3MuonCandidates"),
+            filters = cms.vstring(), vetoFilters = cms.vstring(),
             l1seed = cms.string("type(-81) && coll('hltGtStage2Digis:Muon')"), l1deltaR = cms.double(0.5),
             l2seed = cms.string("type(83) && coll('hltL2MuonCandidates')"),  l2deltaR = cms.double(0.3),
-            qualityBits = cms.string("filter('*RelTrkIsoVVLFiltered0p4') + 2*filter('hltL3crIso*Filtered')"), qualityBitsDoc = cms.string("1 = TrkIsoVVL, 2 = Iso"),
+            qualityBitsFilters = cms.vstring("*RelTrkIsoVVLFiltered0p4", "hltL3crIso*Filtered"), qualityBitsDoc = cms.string("1 = TrkIsoVVL, 2 = Iso"),
         ),
         cms.PSet(
             name = cms.string("Tau"),
             id = cms.int32(14),
-            sel = cms.string("type(84) && pt > 5 && coll('hltPFTaus')"), 
+            type = cms.int32(84), ptMin = cms.double(5), coll = cms.string("hltPFTaus"),
+            filters = cms.vstring(), vetoFilters = cms.vstring(),
             l1seed = cms.string("type(-100) && coll('hltGtStage2Digis:Tau')"), l1deltaR = cms.double(0.3),
             l2seed = cms.string("type(84) && coll('hltL2TauJetsL1IsoTauSeeded')"),  l2deltaR = cms.double(0.3),
-            qualityBits = cms.string("0"), qualityBitsDoc = cms.string(""),
+            qualityBitsFilters = cms.vstring(), qualityBitsDoc = cms.string(""),
         ),
         cms.PSet(
             name = cms.string("Jet"),
             id = cms.int32(1),
-            sel = cms.string("type(85) && pt > 30 && coll('hltAK4PFJetsCorrected')"), 
+            type = cms.int32(85), ptMin = cms.double(30), coll = cms.string("hltAK4PFJetsCorrected"),
+            filters = cms.vstring(), vetoFilters = cms.vstring(),
             l1seed = cms.string("type(-99) && coll('hltGtStage2Digis:Jet')"), l1deltaR = cms.double(0.3),
             l2seed = cms.string("type(85)  && coll('hltAK4CaloJetsCorrectedIDPassed')"),  l2deltaR = cms.double(0.3),
-            qualityBits = cms.string("0"), qualityBitsDoc = cms.string(""),
+            qualityBitsFilters = cms.vstring(), qualityBitsDoc = cms.string(""),
         ),
         cms.PSet(
             name = cms.string("MET"),
             id = cms.int32(2),
-            sel = cms.string("type(87) && pt > 30 && coll('hltPFMETProducer')"), 
+            type = cms.int32(87), ptMin = cms.double(30), coll = cms.string("hltPFMETProducer"),
+            filters = cms.vstring(), vetoFilters = cms.vstring(),
             l1seed = cms.string("type(-87) && coll('hltGtStage2Digis:EtSum')"), l1deltaR = cms.double(9999),
             l2seed = cms.string("type( 87) && coll('hltMetClean')"),  l2deltaR = cms.double(9999),
-            qualityBits = cms.string("0"), qualityBitsDoc = cms.string(""),
+            qualityBitsFilters = cms.vstring(), qualityBitsDoc = cms.string(""),
         ),
         cms.PSet(
             name = cms.string("HT"),
             id = cms.int32(3),
-            sel = cms.string("type(89) && pt > 100 && coll('hltPFHTJet30')"), 
+            type = cms.int32(89), ptMin = cms.double(100), coll = cms.string("hltPFHTJet30"),
+            filters = cms.vstring(), vetoFilters = cms.vstring(),
             l1seed = cms.string("type(-89) && coll('hltGtStage2Digis:EtSum')"), l1deltaR = cms.double(9999),
             #l2seed = cms.string("type(89) && coll('hltHtMhtJet30')"),  l2deltaR = cms.double(9999),
-            qualityBits = cms.string("0"), qualityBitsDoc = cms.string(""),
+            qualityBitsFilters = cms.vstring(), qualityBitsDoc = cms.string(""),
         ),
         cms.PSet(
             name = cms.string("MHT"),
             id = cms.int32(4),
-            sel = cms.string("type(90) && pt > 30 && coll('hltPFMHTTightID')"), 
+            type = cms.int32(90), ptMin = cms.double(30), coll = cms.string("hltPFMHTTightID"),
+            filters = cms.vstring(), vetoFilters = cms.vstring(),
             l1seed = cms.string("type(-90) && coll('hltGtStage2Digis:EtSum')"), l1deltaR = cms.double(9999),
             #l2seed = cms.string("type(90) && coll('hltHtMhtJet30')"),  l2deltaR = cms.double(9999),
-            qualityBits = cms.string("0"), qualityBitsDoc = cms.string(""),
+            qualityBitsFilters = cms.vstring(), qualityBitsDoc = cms.string(""),
         ),
 
     ),
 )
 
-triggerObjectTables = cms.Sequence( unpackedPatTrigger + triggerObjectTable )
+triggerObjectKinematics = cms.EDProducer("CandidateKinematicsProducer",
+    src = cms.InputTag("slimmedPatTrigger"), # must be the src of triggerObjectTable, which checks it
+)
+
+triggerObjectTables = cms.Sequence( triggerObjectKinematics + triggerObjectTable )
@@ -4,13 +4,17 @@ from  PhysicsTools.NanoAOD.common_cff import *
 
 
 ##################### User floats producers, selectors ##########################
-
+svGeometry = cms.EDProducer("SVGeometryProducer",
+    pvSrc = cms.InputTag("offlineSlimmedPrimaryVertices"),
+    svSrc = cms.InputTag("slimmedSecondaryVertices"),
+)
 
 
 ##################### Tables for final output and docs ##########################
 vertexTable = cms.EDProducer("VertexTableProducer",
     pvSrc = cms.InputTag("offlineSlimmedPrimaryVertices"),
     svSrc = cms.InputTag("slimmedSecondaryVertices"),
+    svGeometry = cms.InputTag("svGeometry"),
     svCut = cms.string(""),
     dlenMin = cms.double(0),
     dlenSigMin = cms.double(3),
@@ -38,7 +42,7 @@ svCandidateTable.variables.phi.precision=12
 
 
 #before cross linking
-vertexSequence = cms.Sequence()
+vertexSequence = cms.Sequence(svGeometry)
 #after cross linkining
 vertexTables = cms.Sequence( vertexTable+svCandidateTable)
 
@@ -0,0 +1,192 @@
+#!/usr/bin/env python
+from __future__ import print_function
+
+## Turns TMVA BDTG weight files into C++ code that registers the forests in BDTForestRegistry, so that the
+## modules using those weight files (BaseMVAValueMapProducer with the native backend) get them without parsing the xml.
+##
+## Usage:  nanoCompileBDT.py weights.xml [ output ]
+##         nanoCompileBDT.py --manifest compiledBDT.txt --src-dir $CMSSW_BASE/src output
+##
+## The second form is run by scram when building the plugins (see plugins/BuildFile.xml): it compiles all the weight files
+## listed in the manifest (data/compiledBDT.txt, with their name as given to edm::FileInPath and their hash) into a single
+## header, and fails if a weight file does not have its hash anymore, so that weights are not changed by mistake.
+## The forests are registered under the hash of the weight file, and also under its name, size and modification
+## time, which lets BDTForestRegistry skip reading the file when it has not changed since it was compiled.
+## The trees are stored as constant node tables with the same layout and the same float values as
+## BDTForest::fromTMVAXML, so the results are identical to the parsed forest.
+
+import sys, os, os.path, re, struct
+from fractions import Fraction
+import xml.etree.ElementTree as ET
+
+def contentHash(data):
+    "FNV-1a, as BDTForestRegistry::contentHash"
+    h = 14695981039346656037
+    for c in bytearray(data):
+        h = ((h ^ c) * 1099511628211) & 0xFFFFFFFFFFFFFFFF
+    return h
+
+def nearestFloat(text):
+    "the float nearest to the decimal number in text, as read by the xml parser (istream >> float)"
+    exact = Fraction(text.strip())
+    bits = struct.unpack("<I", struct.pack("<f", float(exact)))[0]
+    # the conversion through double can be off by one float: check the neighbours, with ties to even
+    candidates = [bits] + [b for b in (bits-1, bits+1) if 0 <= b < 0x7f800000 or 0x80000000 <= b < 0xff800000]
+    def distance(b):
+        return (abs(Fraction(struct.unpack("<f", struct.pack("<I", b))[0]) - exact), b & 1)
+    return struct.unpack("<f", struct.pack("<I", min(candidates, key=distance)))[0]
+
+def floatLiteral(text):
+    "shortest literal that the compiler rounds to the same float as the xml parser"
+    ret = "%.9g" % nearestFloat(text)
+    if not any(c in ret for c in ".eE"): ret += "."
+    return ret + "f"
+
+class XMLNode:
+    def __init__(self, elem):
+        if int(elem.get("NCoef")) != 0: raise RuntimeError("Fisher cuts are not supported")
+        self.var = int(elem.get("IVar"))
+        self.cut = elem.get("Cut")
+        self.cutType = int(elem.get("cType")) != 0
+        self.response = elem.get("res")
+        self.leaf = int(elem.get("nType")) != 0
+        self.left = self.right = None
+        for child in elem.findall("Node"):
+            if child.get("pos") == "l": self.left = XMLNode(child)
+            elif child.get("pos") == "r": self.right = XMLNode(child)
+            else: raise RuntimeError("Bad node position %s" % child.get("pos"))
+
+def flatten(root, nvars):
+    "same layout as BDTForest::fromTMVAXMLText: breadth first, the two children of a node next to each other, the one for x < cut first"
+    nodes = [None]
+    todo = [(root, 0, 0)]
+    depth = 0
+    for (xn, flat, d) in todo:
+        if xn.leaf:
+            nodes[flat] = (-1, "0.f", 0, floatLiteral(xn.response))
+            depth = max(depth, d)
+            continue
+        if xn.left is None or xn.right is None: raise RuntimeError("Internal node without two children")
+        if xn.var < 0 or xn.var >= nvars: raise RuntimeError("Bad variable index")
+        nodes[flat] = (xn.var, floatLiteral(xn.cut), len(nodes), floatLiteral(xn.response))
+        below, above = (xn.left, xn.right) if xn.cutType else (xn.right, xn.left)
+        todo.append((below, len(nodes), d+1))
+        todo.append((above, len(nodes)+1, d+1))
+        nodes += [None, None]
+    return nodes, depth
+
+def readForest(data):
+    "variables, analysis type and trees of the content of a weight file"
+    root = ET.fromstring(data)
+    method = root.get("Method", "")
+    info = dict((i.get("name"), i.get("value")) for i in root.iter("Info"))
+    options = dict((o.get("name"), (o.text or "").strip()) for o in root.iter("Option"))
+    if not method.startswith("BDT") or options.get("BoostType") != "Grad":
+        raise RuntimeError("Only BDTs with BoostType=Grad are supported (method %s, boost type %s)" % (method, options.get("BoostType")))
+    analysisType = info.get("AnalysisType")
+    if analysisType not in ("Classification", "Regression"):
+        raise RuntimeError("Unsupported analysis type %s" % analysisType)
+    for t in root.iter("Transformations"):
+        if int(t.get("NTransformations")) != 0: raise RuntimeError("Variable transformations are not supported")
+    variables = {}
+    for v in root.iter("Variable"):
+        variables[int(v.get("VarIndex"))] = v.get("Expression")
+    variables = [variables[i] for i in range(len(variables))]
+
+    trees = []
+    for bt in root.iter("BinaryTree"):
+        if bt.get("type") != "DecisionTree": raise RuntimeError("Unsupported tree type %s" % bt.get("type"))
+        top = bt.find("Node")
+        if top is None: raise RuntimeError("Empty tree")
+        trees.append((bt.get("boostWeight"), flatten(XMLNode(top), len(variables))))
+    if not trees: raise RuntimeError("No trees")
+    return variables, analysisType, trees
+
+def writeForest(out, xmlName, fileName=None, expectedHash=None):
+    """writes the code of the forest of a weight file, in its own namespace; if fileName (the name given to edm::FileInPath)
+    is set, the forest is also registered under the name, size and modification time of the file"""
+    data = open(xmlName, "rb").read()
+    hash = contentHash(data)
+    if expectedHash is not None and hash != expectedHash:
+        raise RuntimeError("%s has hash 0x%016x instead of 0x%016x: if the new weights are right, update the hash" % (xmlName, hash, expectedHash))
+    variables, analysisType, trees = readForest(data)
+
+    out.write("namespace %s { // from %s\n" % (re.sub("[^A-Za-z0-9_]", "_", os.path.basename(xmlName)), os.path.basename(xmlName)))
+    out.write("    // var, cut, children (index within the tree), response\n")
+    out.write("    constexpr BDTForest::Node nodes[] = {\n")
+    first = 0
+    treeInfo = []
+    for (boostWeight, (nodes, depth)) in trees:
+        for (var, cut, children, response) in nodes:
+            out.write("        {%d, %s, %d, %s},\n" % (var, cut, children, response))
+        treeInfo.append((first, len(nodes), depth))
+        first += len(nodes)
+    out.write("    };\n")
+    out.write("    // first node, number of nodes, depth\n")
+    out.write("    constexpr unsigned int trees[][3] = {\n")
+    for t in treeInfo:
+        out.write("        {%d, %d, %d},\n" % t)
+    out.write("    };\n\n")
+    out.write("    BDTForest build() {\n")
+    out.write("        BDTForest ret;\n")
+    out.write("        ret.setVariables({%s});\n" % ", ".join('"%s"' % v.replace("\\", "\\\\").replace('"', '\\"') for v in variables))
+    out.write("        ret.setRegression(%s, %s);\n" % ("true" if analysisType == "Regression" else "false", trees[0][0]))
+    out.write("        for (const auto & tree : trees) ret.addTree(std::vector<BDTForest::Node>(nodes + tree[0], nodes + tree[0] + tree[1]), tree[2]);\n")
+    out.write("        return ret;\n")
+    out.write("    }\n\n")
+    if fileName is None:
+        out.write("    BDTForestRegistry::Compiled registration(0x%016xull, &build);\n" % hash)
+    else:
+        st = os.stat(xmlName)
+        out.write('    BDTForestRegistry::Compiled registration(0x%016xull, &build, "%s", %dull, %dll);\n' % (hash, fileName, st.st_size, int(st.st_mtime)))
+    out.write("}\n")
+
+def readManifest(manifestName):
+    "(name as given to edm::FileInPath, hash) of the weight files of a manifest"
+    ret = []
+    for line in open(manifestName):
+        line = line.split("#")[0].strip()
+        if not line: continue
+        name, hash = line.split()
+        ret.append((name, int(hash, 16)))
+    return ret
+
+def main(args):
+    usage = "Usage: nanoCompileBDT.py weights.xml [ output ]\n       nanoCompileBDT.py --manifest compiledBDT.txt --src-dir dir output"
+    manifest = srcDir = None
+    while args and args[0] in ("--manifest", "--src-dir") and len(args) > 1:
+        if args[0] == "--manifest": manifest = args[1]
+        else: srcDir = args[1]
+        args = args[2:]
+    if (manifest is None) != (srcDir is None) or len(args) not in ((1,) if manifest else (1, 2)):
+        print(usage, file=sys.stderr)
+        return 1
+    if manifest:
+        forests = [(os.path.join(srcDir, name), name, hash) for (name, hash) in readManifest(manifest)]
+        outName = args[0]
+    else:
+        forests = [(args[0], None, None)]
+        outName = args[1] if len(args) == 2 else None
+
+    # written to a temporary file and renamed, so that a failure does not leave a partial output behind
+    out = open(outName + ".tmp", "w") if outName else sys.stdout
+    try:
+        out.write("// Generated by nanoCompileBDT.py from %s, do not edit\n" % ", ".join(os.path.basename(f[0]) for f in forests))
+        out.write('#include "PhysicsTools/NanoAOD/interface/BDTForestRegistry.h"\n\n')
+        out.write("namespace {\n")
+        for (xmlName, fileName, expectedHash) in forests:
+            writeForest(out, xmlName, fileName, expectedHash)
+        out.write("}\n")
+    except Exception as e:
+        if outName:
+            out.close()
+            os.remove(outName + ".tmp")
+        print("nanoCompileBDT.py: %s" % e, file=sys.stderr)
+        return 1
+    if outName:
+        out.close()
+        os.rename(outName + ".tmp", outName)
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
@@ -0,0 +1,293 @@
+#include <PhysicsTools/NanoAOD/interface/BDTForest.h>
+#include <FWCore/Utilities/interface/Exception.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <limits>
+#include <map>
+#include <sstream>
+
+namespace {
+    /// minimal reader of the xml written by TMVA: returns the tags one by one, with their attributes and the text that follows them
+    class TMVAXMLTagReader {
+        public:
+            TMVAXMLTagReader(const std::string & text) : text_(text), pos_(0) {}
+
+            struct Tag {
+                std::string name; // starts with '/' for closing tags
+                bool selfClosing;
+                std::map<std::string,std::string> attrs;
+                std::string text; // up to the next tag
+                const std::string & attr(const std::string & name) const {
+                    auto match = attrs.find(name);
+                    if (match == attrs.end()) throw cms::Exception("Configuration", "Missing attribute "+name+" in TMVA xml tag "+this->name+"\n");
+                    return match->second;
+                }
+            };
+
+            bool next(Tag & tag) {
+                while (true) {
+                    size_t start = text_.find('<', pos_);
+                    if (start == std::string::npos) return false;
+                    size_t end = text_.find('>', start);
+                    if (end == std::string::npos) throw cms::Exception("Configuration", "Truncated TMVA xml\n");
+                    pos_ = end+1;
+                    if (text_[start+1] == '?' || text_[start+1] == '!') continue; // declaration or comment
+                    tag.attrs.clear();
+                    tag.selfClosing = (text_[end-1] == '/');
+                    size_t i = start+1, stop = tag.selfClosing ? end-1 : end;
+                    size_t nameEnd = text_.find_first_of(" \t\r\n", i);
+                    if (nameEnd == std::string::npos || nameEnd > stop) nameEnd = stop;
+                    tag.name = text_.substr(i, nameEnd-i);
+                    for (i = nameEnd; i < stop; ) {
+                        size_t eq = text_.find('=', i);
+                        if (eq == std::string::npos || eq >= stop) break;
+                        size_t q1 = text_.find('"', eq), q2 = text_.find('"', q1+1);
+                        size_t nameStart = text_.find_first_not_of(" \t\r\n", i);
+                        tag.attrs[text_.substr(nameStart, eq-nameStart)] = text_.substr(q1+1, q2-q1-1);
+                        i = q2+1;
+                    }
+                    size_t textEnd = text_.find('<', pos_);
+                    tag.text = text_.substr(pos_, (textEnd == std::string::npos ? text_.size() : textEnd) - pos_);
+                    return true;
+                }
+            }
+
+        private:
+            const std::string & text_;
+            size_t pos_;
+    };
+
+    /// a node as read from the xml
+    struct XMLNode {
+        int var;
+        float cut;
+        bool cutType;
+        float response;
+        bool leaf;
+        int left, right;
+    };
+
+    // same conversions as TMVA, which reads the attributes through a stringstream into Float_t or Double_t
+    template<typename T> T readNumber(const std::string & text) {
+        T ret; std::istringstream str(text); str >> ret;
+        if (str.fail()) throw cms::Exception("Configuration", "Bad number '"+text+"' in TMVA xml\n");
+        return ret;
+    }
+}
+
+BDTForest
+BDTForest::fromTMVAXML(const std::string & fileName)
+{
+    std::ifstream file(fileName);
+    if (!file.good()) throw cms::Exception("Configuration", "Can not read "+fileName+"\n");
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return fromTMVAXMLText(buffer.str(), fileName);
+}
+
+BDTForest
+BDTForest::fromTMVAXMLText(const std::string & text, const std::string & fileName)
+{
+    BDTForest ret;
+    std::string analysisType, boostType, method;
+    std::vector<std::string> vars;
+    std::vector<XMLNode> tree;
+    std::vector<int> stack;
+    std::vector<double> boostWeights;
+
+    TMVAXMLTagReader reader(text);
+    TMVAXMLTagReader::Tag tag;
+    while (reader.next(tag)) {
+        if (tag.name == "MethodSetup") {
+            method = tag.attr("Method");
+        } else if (tag.name == "Info" && tag.attrs.count("name") && tag.attrs["name"] == "AnalysisType") {
+            analysisType = tag.attr("value");
+        } else if (tag.name == "Option" && tag.attrs.count("name") && tag.attrs["name"] == "BoostType") {
+            boostType = tag.text;
+        } else if (tag.name == "Variable") {
+            unsigned int index = readNumber<unsigned int>(tag.attr("VarIndex"));
+            if (vars.size() <= index) vars.resize(index+1);
+            vars[index] = tag.attr("Expression");
+        } else if (tag.name == "Transformations") {
+            if (readNumber<int>(tag.attr("NTransformations")) != 0) throw cms::Exception("Configuration", "Variable transformations are not supported, in "+fileName+"\n");
+        } else if (tag.name == "BinaryTree") {
+            if (tag.attr("type") != "DecisionTree") throw cms::Exception("Configuration", "Unsupported tree type "+tag.attr("type")+" in "+fileName+"\n");
+            boostWeights.push_back(readNumber<double>(tag.attr("boostWeight")));
+            tree.clear(); stack.clear();
+        } else if (tag.name == "Node") {
+            if (readNumber<int>(tag.attr("NCoef")) != 0) throw cms::Exception("Configuration", "Fisher cuts are not supported, in "+fileName+"\n");
+            XMLNode node;
+            node.var = readNumber<int>(tag.attr("IVar"));
+            node.cut = readNumber<float>(tag.attr("Cut"));
+            node.cutType = readNumber<int>(tag.attr("cType")) != 0;
+            node.response = readNumber<float>(tag.attr("res"));
+            node.leaf = readNumber<int>(tag.attr("nType")) != 0; // as DecisionTree::CheckEvent, that stops at the first node with nType != 0
+            node.left = node.right = -1;
+            int index = tree.size();
+            const std::string & pos = tag.attr("pos");
+            if (!stack.empty()) {
+                if (pos == "l") tree[stack.back()].left = index;
+                else if (pos == "r") tree[stack.back()].right = index;
+                else throw cms::Exception("Configuration", "Bad node position "+pos+" in "+fileName+"\n");
+            }
+            tree.push_back(node);
+            if (!tag.selfClosing) stack.push_back(index);
+        } else if (tag.name == "/Node") {
+            stack.pop_back();
+        } else if (tag.name == "/BinaryTree") {
+            if (tree.empty()) throw cms::Exception("Configuration", "Empty tree in "+fileName+"\n");
+            // lay out the tree with the two children of each node next to each other, the one for x < cut first
+            std::vector<Node> nodes(1);
+            std::vector<std::pair<int,unsigned int>> todo(1, std::make_pair(0, 0u)); // (xml node, flat node)
+            std::vector<unsigned int> depthOf(1, 0);
+            unsigned int depth = 0;
+            for (unsigned int it = 0; it < todo.size(); ++it) {
+                const XMLNode & xn = tree[todo[it].first];
+                unsigned int flat = todo[it].second;
+                Node & node = nodes[flat];
+                node.response = xn.response;
+                if (xn.leaf) {
+                    node.var = -1; node.cut = 0; node.children = 0;
+                    depth = std::max(depth, depthOf[flat]);
+                    continue;
+                }
+                if (xn.left == -1 || xn.right == -1) throw cms::Exception("Configuration", "Internal node without two children in "+fileName+"\n");
+                if (xn.var < 0 || xn.var >= int(vars.size())) throw cms::Exception("Configuration", "Bad variable index in "+fileName+"\n");
+                node.var = xn.var; node.cut = xn.cut; node.children = nodes.size();
+                // TMVA goes right if (x >= cut) == cType
+                int below = xn.cutType ? xn.left : xn.right, above = xn.cutType ? xn.right : xn.left;
+                todo.emplace_back(below, nodes.size());
+                todo.emplace_back(above, nodes.size()+1);
+                depthOf.push_back(depthOf[flat]+1);
+                depthOf.push_back(depthOf[flat]+1);
+                nodes.resize(nodes.size()+2);
+            }
+            ret.addTree(nodes, depth);
+        }
+    }
+
+    if (method.compare(0, 3, "BDT") != 0 || boostType != "Grad") {
+        throw cms::Exception("Configuration", "Only BDTs with BoostType=Grad are supported, in "+fileName+" (method "+method+", boost type "+boostType+")\n");
+    }
+    if (analysisType != "Classification" && analysisType != "Regression") {
+        throw cms::Exception("Configuration", "Unsupported analysis type "+analysisType+" in "+fileName+"\n");
+    }
+    if (boostWeights.empty()) throw cms::Exception("Configuration", "No trees in "+fileName+"\n");
+    ret.setVariables(vars);
+    ret.setRegression(analysisType == "Regression", boostWeights.front());
+    return ret;
+}
+
+void
+BDTForest::addTree(const std::vector<Node> & nodes, unsigned int depth)
+{
+    uint32_t offset = cut_.size();
+    treeRoot_.push_back(offset);
+    treeDepth_.push_back(depth);
+    for (unsigned int i = 0, n = nodes.size(); i < n; ++i) {
+        const Node & node = nodes[i];
+        if (node.var >= 0) {
+            var_.push_back(node.var);
+            cut_.push_back(node.cut);
+            children_.push_back(offset + node.children);
+        } else {
+            // leaves stay where they are: no input is >= NaN
+            var_.push_back(0);
+            cut_.push_back(std::numeric_limits<float>::quiet_NaN());
+            children_.push_back(offset + i);
+        }
+        response_.push_back(node.response);
+    }
+}
+
+void
+BDTForest::evaluate(const float * inputs, unsigned int n, float * out) const
+{
+    const unsigned int nvars = variables_.size();
+    std::vector<double> sum(n, 0.);
+    std::vector<uint32_t> node(n);
+    // loop on the trees outside, so that each tree is read from memory once for all the objects
+    for (unsigned int t = 0, nt = treeRoot_.size(); t < nt; ++t) {
+        std::fill(node.begin(), node.end(), treeRoot_[t]);
+        for (unsigned int d = 0, nd = treeDepth_[t]; d < nd; ++d) {
+            for (unsigned int j = 0; j < n; ++j) {
+                uint32_t i = node[j];
+                node[j] = children_[i] + (inputs[j*nvars + var_[i]] >= cut_[i]);
+            }
+        }
+        for (unsigned int j = 0; j < n; ++j) sum[j] += response_[node[j]];
+    }
+    for (unsigned int j = 0; j < n; ++j) {
+        out[j] = regression_ ? sum[j] + offset_ : 2.0/(1.0+std::exp(-2.0*sum[j]))-1;
+    }
+}
+
+namespace {
+    const uint32_t kBinaryMagic = 0x46544442, kBinaryVersion = 1; // "BDTF"
+
+    template<typename T> void writePOD(std::ostream & out, const T & value) { out.write(reinterpret_cast<const char *>(&value), sizeof(T)); }
+    template<typename T> void writeVector(std::ostream & out, const std::vector<T> & vec) {
+        writePOD<uint64_t>(out, vec.size());
+        out.write(reinterpret_cast<const char *>(vec.data()), vec.size()*sizeof(T));
+    }
+    template<typename T> bool readPOD(std::istream & in, T & value) { return bool(in.read(reinterpret_cast<char *>(&value), sizeof(T))); }
+    template<typename T> bool readVector(std::istream & in, std::vector<T> & vec, uint64_t maxSize) {
+        uint64_t size;
+        if (!readPOD(in, size) || size > maxSize) return false;
+        vec.resize(size);
+        return bool(in.read(reinterpret_cast<char *>(vec.data()), size*sizeof(T)));
+    }
+}
+
+void
+BDTForest::writeBinary(std::ostream & out) const
+{
+    writePOD(out, kBinaryMagic);
+    writePOD(out, kBinaryVersion);
+    writePOD<uint8_t>(out, regression_);
+    writePOD(out, offset_);
+    writePOD<uint64_t>(out, variables_.size());
+    for (const std::string & var : variables_) {
+        writePOD<uint64_t>(out, var.size());
+        out.write(var.data(), var.size());
+    }
+    writeVector(out, var_);
+    writeVector(out, cut_);
+    writeVector(out, children_);
+    writeVector(out, response_);
+    writeVector(out, treeRoot_);
+    writeVector(out, treeDepth_);
+}
+
+bool
+BDTForest::readBinary(std::istream & in)
+{
+    const uint64_t maxSize = 1 << 30;
+    uint32_t magic, version;
+    uint8_t regression;
+    uint64_t nvars;
+    if (!readPOD(in, magic) || magic != kBinaryMagic || !readPOD(in, version) || version != kBinaryVersion) return false;
+    if (!readPOD(in, regression) || !readPOD(in, offset_) || !readPOD(in, nvars) || nvars > maxSize) return false;
+    regression_ = regression;
+    variables_.resize(nvars);
+    for (std::string & var : variables_) {
+        uint64_t size;
+        if (!readPOD(in, size) || size > maxSize) return false;
+        var.resize(size);
+        if (!in.read(&var[0], size)) return false;
+    }
+    if (!readVector(in, var_, maxSize) || !readVector(in, cut_, maxSize) || !readVector(in, children_, maxSize) || !readVector(in, response_, maxSize)) return false;
+    if (!readVector(in, treeRoot_, maxSize) || !readVector(in, treeDepth_, maxSize)) return false;
+    // sanity checks, so that a corrupted file can not make the evaluation read out of bounds
+    unsigned int nnodes = cut_.size();
+    if (var_.size() != nnodes || children_.size() != nnodes || response_.size() != nnodes || treeDepth_.size() != treeRoot_.size()) return false;
+    for (unsigned int i = 0; i < nnodes; ++i) {
+        if (var_[i] < 0 || var_[i] >= int(nvars) || children_[i] >= nnodes || (children_[i] != i && children_[i]+1 >= nnodes)) return false;
+    }
+    for (uint32_t root : treeRoot_) if (root >= nnodes) return false;
+    return true;
+}
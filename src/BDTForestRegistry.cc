@@ -0,0 +1,88 @@
+#include <PhysicsTools/NanoAOD/interface/BDTForestRegistry.h>
+#include <FWCore/Utilities/interface/Exception.h>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+std::mutex BDTForestRegistry::mutex_;
+std::map<std::string, std::shared_ptr<BDTForestRegistry::Entry>> BDTForestRegistry::forests_;
+
+BDTForestRegistry::ForestPtr
+BDTForestRegistry::get(const std::string & fileName, bool useBinaryCache)
+{
+    std::shared_ptr<Entry> entry;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto & ret = forests_[fileName];
+        if (!ret) ret = std::make_shared<Entry>();
+        entry = ret;
+    }
+    // if load throws, the next request tries again
+    std::call_once(entry->loaded, [&]() { entry->forest = load(fileName, useBinaryCache); });
+    return entry->forest;
+}
+
+uint64_t
+BDTForestRegistry::contentHash(const std::string & content)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : content) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+BDTForestRegistry::ForestPtr
+BDTForestRegistry::load(const std::string & fileName, bool useBinaryCache)
+{
+    // a compiled forest for this very file (as installed with the release), no need to read it
+    struct stat info;
+    if (::stat(fileName.c_str(), &info) == 0) {
+        for (const auto & c : compiled()) {
+            const std::string & name = c.second.fileName;
+            if (name.empty() || name.size() > fileName.size() || fileName.compare(fileName.size()-name.size(), name.size(), name) != 0) continue;
+            if (name.size() < fileName.size() && fileName[fileName.size()-name.size()-1] != '/') continue;
+            if (uint64_t(info.st_size) == c.second.size && int64_t(info.st_mtime) == c.second.mtime) return std::make_shared<const BDTForest>(c.second.builder());
+        }
+    }
+
+    std::ifstream file(fileName);
+    if (!file.good()) throw cms::Exception("Configuration", "Can not read "+fileName+"\n");
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    const std::string content = buffer.str();
+    const uint64_t hash = contentHash(content);
+
+    auto builder = compiled().find(hash);
+    if (builder != compiled().end()) return std::make_shared<const BDTForest>(builder->second.builder());
+
+    const std::string cacheName = binaryCacheName(fileName);
+    if (useBinaryCache) {
+        std::ifstream cache(cacheName, std::ios::binary);
+        uint64_t cachedHash;
+        if (cache.good() && cache.read(reinterpret_cast<char *>(&cachedHash), sizeof(cachedHash)) && cachedHash == hash) {
+            std::shared_ptr<BDTForest> forest(new BDTForest());
+            if (forest->readBinary(cache)) return forest;
+        }
+    }
+
+    std::shared_ptr<BDTForest> forest(new BDTForest(BDTForest::fromTMVAXMLText(content, fileName)));
+
+    if (useBinaryCache) {
+        // written to a temporary file and renamed, so that concurrent jobs never read a partial cache; failures are not errors
+        std::ostringstream tmpName;
+        tmpName << cacheName << ".tmp" << getpid();
+        std::ofstream cache(tmpName.str(), std::ios::binary);
+        if (cache.good()) {
+            cache.write(reinterpret_cast<const char *>(&hash), sizeof(hash));
+            forest->writeBinary(cache);
+            cache.close();
+            if (!cache.good() || std::rename(tmpName.str().c_str(), cacheName.c_str()) != 0) std::remove(tmpName.str().c_str());
+        }
+    }
+    return forest;
+}
@@ -3,6 +3,10 @@
 #include <PhysicsTools/NanoAOD/interface/FlatTable.h>
 #include <PhysicsTools/NanoAOD/interface/MergableCounterTable.h>
 #include <PhysicsTools/NanoAOD/interface/UniqueString.h>
+#include <PhysicsTools/NanoAOD/interface/CandidateKinematics.h>
+#include <PhysicsTools/NanoAOD/interface/GenHistory.h>
+#include <PhysicsTools/NanoAOD/interface/SVGeometry.h>
+#include <PhysicsTools/NanoAOD/interface/PackedCandidateTrackQuality.h>
 #include "DataFormats/Common/interface/Wrapper.h"
 
 namespace PhysicsTools_NanoAOD {
@@ -10,5 +14,9 @@ namespace PhysicsTools_NanoAOD {
         edm::Wrapper<FlatTable> w_table;
         edm::Wrapper<MergableCounterTable> w_mtable;
         edm::Wrapper<UniqueString> w_ustr;
+        edm::Wrapper<CandidateKinematics> w_ckin;
+        edm::Wrapper<GenHistory> w_ghist;
+        edm::Wrapper<SVGeometry> w_svgeom;
+        edm::Wrapper<PackedCandidateTrackQuality> w_pctq;
     };
 }
@@ -53,10 +53,11 @@ process.out1 = cms.OutputModule("NanoAODOutputModule",
 process.end = cms.EndPath(process.out1) 
 #process.end = cms.EndPath(process.out+process.out1) 
 process.jetTable.variables.qgl.expr="-1"
-process.unpackedPatTrigger.patTriggerObjectsStandAlone = "selectedPatTrigger"
+process.triggerObjectTable.src = "selectedPatTrigger"
+process.triggerObjectTable.unpackFilterLabels = False # the 80X trigger objects are stored with their filter labels
+process.triggerObjectKinematics.src = "selectedPatTrigger"
 process.fatJetTable.variables.mpruned.expr = cms.string("userFloat(\'ak8PFJetsCHSPrunedMass\')")
 process.fatJetTable.variables.msoftdrop.expr = cms.string("userFloat(\'ak8PFJetsCHSSoftDropMass\')")
 process.fatJetTable.variables.tau1.expr = cms.string("userFloat(\'NjettinessAK8:tau1\')")
 process.fatJetTable.variables.tau2.expr = cms.string("userFloat(\'NjettinessAK8:tau2\')")
 process.fatJetTable.variables.tau3.expr = cms.string("userFloat(\'NjettinessAK8:tau3\')")
-process.unpackedPatTrigger.unpackFilterLabels = False
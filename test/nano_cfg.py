@@ -34,6 +34,13 @@ process.RandomNumberGeneratorService = cms.Service("RandomNumberGeneratorService
                                       ),
 )
 process.nanoPath = cms.Path(process.nanoSequenceMC)
+#example of a deltaR match between two tables, written as Tau_genVisTauIdx and Tau_genVisTauDeltaR:
+#process.tauGenVisTauMatchTable = cms.EDProducer("DeltaRMatchTableProducer",
+#    name = process.tauTable.name, src = process.tauTable.src, cut = cms.string(""),
+#    matchName = cms.string("genVisTau"), matchTo = process.genVisTauTable.src, matchCut = process.genVisTauTable.cut,
+#    maxDeltaR = cms.double(0.3), strategy = cms.string("unique"), ptWeight = cms.double(1.0), precision = cms.int32(8),
+#)
+#process.nanoPath += process.tauGenVisTauMatchTable
 process.calibratedPatElectrons.isMC = cms.bool(True)
 process.calibratedPatPhotons.isMC = cms.bool(True)
 #for data:
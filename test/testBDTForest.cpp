@@ -0,0 +1,99 @@
+// Compares the evaluation of the BDTs of PhysicsTools/NanoAOD/data by BDTForest with the one of TMVA::Reader,
+// on random inputs and on the edge cases of the cuts (inputs exactly at a cut, and just below it).
+// Returns a non-zero exit code if any output differs by more than the tolerance.
+
+#include "PhysicsTools/NanoAOD/interface/BDTForest.h"
+#include "FWCore/ParameterSet/interface/FileInPath.h"
+
+#include "TMVA/Reader.h"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <regex>
+#include <string>
+#include <vector>
+
+namespace {
+    /// the cut values of each variable in the weight file
+    std::vector<std::vector<float>> cutsPerVariable(const std::string & fileName, unsigned int nVars) {
+        std::ifstream in(fileName);
+        std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        std::vector<std::vector<float>> ret(nVars);
+        static const std::regex re("<Node [^>]*IVar=\"(-?[0-9]+)\"[^>]*Cut=\"([^\"]+)\"[^>]*nType=\"0\"");
+        for (std::sregex_iterator it(text.begin(), text.end(), re), end; it != end; ++it) {
+            int var = std::stoi((*it)[1]);
+            if (var >= 0 && var < int(nVars)) ret[var].push_back(std::stof((*it)[2]));
+        }
+        return ret;
+    }
+
+    /// returns the number of mismatches
+    unsigned int compare(const std::string & file, const std::string & method, unsigned int nRandom) {
+        const std::string fullPath = edm::FileInPath(file).fullPath();
+        BDTForest forest = BDTForest::fromTMVAXML(fullPath);
+        const unsigned int nVars = forest.variables().size();
+
+        std::vector<float> values(nVars);
+        TMVA::Reader reader("!Color:Silent");
+        for (unsigned int i = 0; i < nVars; ++i) reader.AddVariable(forest.variables()[i], &values[i]);
+        reader.BookMVA(method, fullPath);
+
+        // inputs: random values in the range of the cuts of each variable, then each input at each of its cuts,
+        // just below it, and at a few extreme values, the others being random
+        std::vector<std::vector<float>> cuts = cutsPerVariable(fullPath, nVars);
+        std::mt19937 rng(12345);
+        std::vector<float> inputs;
+        auto randomInput = [&]() {
+            for (unsigned int i = 0; i < nVars; ++i) {
+                if (cuts[i].empty()) { inputs.push_back(0); continue; }
+                // a random cut, moved by a random fraction of the distance to another one
+                std::uniform_int_distribution<unsigned int> pick(0, cuts[i].size()-1);
+                std::uniform_real_distribution<float> frac(0, 1);
+                float a = cuts[i][pick(rng)], b = cuts[i][pick(rng)];
+                inputs.push_back(a + frac(rng)*(b-a));
+            }
+        };
+        for (unsigned int j = 0; j < nRandom; ++j) randomInput();
+        const float extremes[] = { 0.f, -0.f, 1e30f, -1e30f, std::numeric_limits<float>::max(), -std::numeric_limits<float>::max() };
+        for (unsigned int i = 0; i < nVars; ++i) {
+            std::vector<float> special(std::begin(extremes), std::end(extremes));
+            for (float cut : cuts[i]) {
+                special.push_back(cut);
+                special.push_back(std::nextafter(cut, -std::numeric_limits<float>::infinity()));
+            }
+            for (float x : special) {
+                randomInput();
+                inputs[inputs.size()-nVars+i] = x;
+            }
+        }
+
+        unsigned int n = inputs.size()/nVars, nBad = 0;
+        std::vector<float> out(n);
+        forest.evaluate(inputs.data(), n, out.data());
+        double maxDiff = 0;
+        for (unsigned int j = 0; j < n; ++j) {
+            std::copy(inputs.begin()+j*nVars, inputs.begin()+(j+1)*nVars, values.begin());
+            double ref = forest.isRegression() ? reader.EvaluateRegression(method)[0] : reader.EvaluateMVA(method);
+            // BDTForest sums the responses in float, TMVA in double
+            double diff = std::abs(out[j] - ref), tolerance = 1e-5 * std::max(1.0, std::abs(ref));
+            maxDiff = std::max(maxDiff, diff);
+            if (!(diff <= tolerance) || out[j] != forest.evaluate(&inputs[j*nVars])) {
+                if (nBad++ < 10) std::printf("%s: mismatch for object %u: BDTForest %.8g, TMVA %.8g\n", file.c_str(), j, out[j], ref);
+            }
+        }
+        std::printf("%s: %u inputs, %u trees, %u mismatches, largest difference %.3g\n", file.c_str(), n, forest.nTrees(), nBad, maxDiff);
+        return nBad;
+    }
+}
+
+int main() {
+    unsigned int nBad = 0;
+    nBad += compare("PhysicsTools/NanoAOD/data/mu_BDTG.weights.xml", "BDTG", 20000);
+    nBad += compare("PhysicsTools/NanoAOD/data/el_BDTG.weights.xml", "BDTG", 20000);
+    nBad += compare("PhysicsTools/NanoAOD/data/bjet-regression.xml", "BDTG", 20000);
+    return nBad == 0 ? 0 : 1;
+}
@@ -0,0 +1,134 @@
+// Compares the deltaR matching strategies of DeltaRMatchTableProducer (closest, unique and ptWeighted, found through
+// matching::EtaPhiGrid) with a brute-force matching over all the pairs, on random events with objects close to each other,
+// across the phi = +-pi boundary, and with cones from much smaller to larger than the eta-phi range of the objects.
+// Returns a non-zero exit code if any match differs.
+
+#include "PhysicsTools/NanoAOD/interface/MatchingUtils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace {
+    struct Objects {
+        std::vector<float> pt, eta, phi;
+        unsigned int size() const { return pt.size(); }
+        void push_back(float apt, float aeta, float aphi) {
+            // phi in [-pi, pi], as for the candidates
+            if (aphi > float(M_PI)) aphi -= float(2*M_PI);
+            if (aphi < -float(M_PI)) aphi += float(2*M_PI);
+            pt.push_back(apt); eta.push_back(aeta); phi.push_back(aphi);
+        }
+    };
+
+    float pairDeltaR2(const Objects & a, unsigned int i, const Objects & b, unsigned int j) {
+        float dr2;
+        matching::deltaR2(a.eta[i], a.phi[i], &b.eta[j], &b.phi[j], 1, &dr2);
+        return dr2;
+    }
+
+    // ---- brute-force references: all the pairs, in index order ----
+
+    std::vector<int> closestReference(const Objects & a, const Objects & b, float maxDR2) {
+        std::vector<int> ret(a.size(), -1);
+        for (unsigned int i = 0; i < a.size(); ++i) {
+            float best = maxDR2;
+            for (unsigned int j = 0; j < b.size(); ++j) {
+                float dr2 = pairDeltaR2(a, i, b, j);
+                if (dr2 < best) { best = dr2; ret[i] = j; }
+            }
+        }
+        return ret;
+    }
+
+    std::vector<int> uniqueReference(const Objects & a, const Objects & b, float maxDR2) {
+        std::vector<std::pair<float,std::pair<unsigned int,unsigned int>>> pairs;
+        for (unsigned int i = 0; i < a.size(); ++i) {
+            for (unsigned int j = 0; j < b.size(); ++j) {
+                float dr2 = pairDeltaR2(a, i, b, j);
+                if (dr2 < maxDR2) pairs.emplace_back(dr2, std::make_pair(i, j));
+            }
+        }
+        std::sort(pairs.begin(), pairs.end());
+        std::vector<int> ret(a.size(), -1);
+        std::vector<bool> used(b.size(), false);
+        for (const auto & p : pairs) {
+            if (ret[p.second.first] == -1 && !used[p.second.second]) { ret[p.second.first] = p.second.second; used[p.second.second] = true; }
+        }
+        return ret;
+    }
+
+    std::vector<int> ptWeightedReference(const Objects & a, const Objects & b, float maxDR2, float ptWeight) {
+        std::vector<int> ret(a.size(), -1);
+        for (unsigned int i = 0; i < a.size(); ++i) {
+            float best = std::numeric_limits<float>::max();
+            for (unsigned int j = 0; j < b.size(); ++j) {
+                float dr2 = pairDeltaR2(a, i, b, j);
+                if (!(dr2 < maxDR2)) continue;
+                float dpt = a.pt[i] > 0 ? ptWeight * (b.pt[j] - a.pt[i])/a.pt[i] : 0;
+                if (dr2 + dpt*dpt < best) { best = dr2 + dpt*dpt; ret[i] = j; }
+            }
+        }
+        return ret;
+    }
+
+    unsigned int check(const char * what, const std::vector<int> & test, const std::vector<int> & ref, unsigned int event, float maxDR) {
+        unsigned int nBad = 0;
+        for (unsigned int i = 0; i < ref.size(); ++i) {
+            if (test[i] == ref[i]) continue;
+            if (nBad++ < 5) std::printf("%s: event %u, deltaR %g, object %u: matched to %d instead of %d\n", what, event, maxDR, i, test[i], ref[i]);
+        }
+        return nBad;
+    }
+}
+
+int main() {
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<float> uEta(-3, 3), uPhi(-M_PI, M_PI), uPt(5, 100), uNear(-0.3, 0.3), u01(0, 1);
+    std::uniform_int_distribution<unsigned int> uN(0, 40);
+    const float cones[] = { 0.01, 0.1, 0.3, 0.4, 0.8, 2.0, 7.0 };
+    const float ptWeight = 2.0;
+
+    unsigned int nBad = 0, nMatches = 0;
+    for (unsigned int event = 0; event < 2000; ++event) {
+        Objects a, b;
+        unsigned int na = uN(rng), nb = uN(rng);
+        for (unsigned int i = 0; i < na; ++i) {
+            // some objects at the phi boundary
+            a.push_back(uPt(rng), uEta(rng), u01(rng) < 0.2 ? float(M_PI) - 0.1f*u01(rng) : uPhi(rng));
+        }
+        for (unsigned int j = 0; j < nb; ++j) {
+            if (na && u01(rng) < 0.6) {
+                // close to an object of a, so that there are several candidates within the cones
+                unsigned int i = std::min<unsigned int>(na-1, u01(rng)*na);
+                b.push_back(a.pt[i]*(0.5f + u01(rng)), a.eta[i] + uNear(rng), a.phi[i] + uNear(rng));
+            } else {
+                b.push_back(uPt(rng), uEta(rng), uPhi(rng));
+            }
+        }
+        // a few exact duplicates, for the ties
+        if (nb > 1 && u01(rng) < 0.2) b.push_back(b.pt[0], b.eta[0], b.phi[0]);
+
+        for (float maxDR : cones) {
+            const float maxDR2 = maxDR*maxDR;
+            matching::EtaPhiGrid grid(b.eta.data(), b.phi.data(), b.size(), maxDR);
+            std::vector<int> closest(a.size()), ptWeighted(a.size());
+            for (unsigned int i = 0; i < a.size(); ++i) {
+                closest[i] = matching::bestMatch(a.eta[i], a.phi[i], grid, maxDR2, [](unsigned int) { return true; }).first;
+                ptWeighted[i] = matching::ptWeightedMatch(a.eta[i], a.phi[i], a.pt[i], grid, b.pt.data(), maxDR2, ptWeight);
+            }
+            std::vector<int> unique = matching::greedyUniqueMatch(a.eta.data(), a.phi.data(), a.size(), grid, b.size(), maxDR2);
+            std::vector<int> ref = closestReference(a, b, maxDR2);
+            for (int m : ref) nMatches += (m >= 0);
+            nBad += check("closest", closest, ref, event, maxDR);
+            nBad += check("unique", unique, uniqueReference(a, b, maxDR2), event, maxDR);
+            nBad += check("ptWeighted", ptWeighted, ptWeightedReference(a, b, maxDR2, ptWeight), event, maxDR);
+        }
+    }
+    std::printf("deltaR matching: %u matches, %u mismatches\n", nMatches, nBad);
+    return nBad == 0 ? 0 : 1;
+}
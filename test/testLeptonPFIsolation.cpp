@@ -0,0 +1,141 @@
+// Compares the mini-isolation sums of PFIsolationProducer (pfIsolation::addSums) with pat::getMiniPFIsolation on random
+// events of packed PF candidates, with the muon parameters and the electron barrel ones (all the veto cones 0). Each lepton
+// is along one of the candidates (deltaR = 0), which the veto cones remove also when they are 0. The candidates closer
+// than 1e-4 in deltaR to a cone boundary are not generated, as the two compute deltaR with different precisions (and a
+// candidate exactly at the outer boundary is counted only by pat::getMiniPFIsolation).
+// Returns a non-zero exit code if any sum differs.
+
+#include "PhysicsTools/NanoAOD/interface/LeptonPFIsolation.h"
+#include "PhysicsTools/PatUtils/interface/MiniIsolation.h"
+#include "DataFormats/PatCandidates/interface/PackedCandidate.h"
+#include "DataFormats/VertexReco/interface/Vertex.h"
+#include "DataFormats/VertexReco/interface/VertexFwd.h"
+#include "DataFormats/Common/interface/TestHandle.h"
+#include "DataFormats/Math/interface/deltaR.h"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+    /// parameters of pat::getMiniPFIsolation
+    struct MiniIsoParams {
+        const char * name;
+        float mindr, maxdr, ktScale, ptThreshold, vetoCh, vetoPU, vetoPh, vetoNh;
+    };
+
+    pfIsolation::Isolation makeIsolation(const MiniIsoParams & p) {
+        pfIsolation::Isolation iso;
+        iso.name = p.name;
+        iso.mini = true;
+        iso.dR = 0; iso.ktScale = p.ktScale; iso.dRMin = p.mindr; iso.dRMax = p.maxdr;
+        iso.setVeto(pfIsolation::Charged, p.vetoCh);
+        iso.setVeto(pfIsolation::PileUp, p.vetoPU);
+        iso.setVeto(pfIsolation::Neutral, p.vetoNh);
+        iso.setVeto(pfIsolation::Photon, p.vetoPh);
+        iso.ptThreshold = p.ptThreshold;
+        iso.vetoSourceCandidates = false;
+        iso.puCorrection = pfIsolation::NoCorrection;
+        iso.deltaBetaFactor = 0;
+        return iso;
+    }
+
+    bool nearBoundary(float dr, float lepPt, const MiniIsoParams & p) {
+        float cone = std::max(p.mindr, std::min(p.maxdr, p.ktScale/lepPt));
+        for (float b : { cone, p.vetoCh, p.vetoPU, p.vetoPh, p.vetoNh }) {
+            if (std::abs(dr - b) < 1e-4) return true;
+        }
+        return false;
+    }
+
+    unsigned int check(const char * what, float test, float ref, unsigned int event, unsigned int lepton, const char * iso) {
+        if (std::abs(test - ref) <= 1e-4*(1 + std::abs(ref))) return 0;
+        std::printf("%s %s: event %u, lepton %u: %g instead of %g\n", iso, what, event, lepton, test, ref);
+        return 1;
+    }
+}
+
+int main() {
+    const MiniIsoParams params[] = {
+        { "muon",        0.05, 0.2, 10.0, 0.5, 0.0001, 0.01, 0.01, 0.01 },
+        { "electronEB",  0.05, 0.2, 10.0, 0.0, 0.0,    0.0,  0.0,  0.0  },
+    };
+    std::vector<pfIsolation::Isolation> isolations;
+    for (const auto & p : params) isolations.push_back(makeIsolation(p));
+    const unsigned int niso = isolations.size();
+
+    // the first vertex is the PV, the candidates of the second one are not from the PV
+    reco::VertexCollection vertices;
+    vertices.emplace_back(reco::Vertex::Point(0, 0, 0), reco::Vertex::Error());
+    vertices.emplace_back(reco::Vertex::Point(0, 0, 3), reco::Vertex::Error());
+    edm::TestHandle<reco::VertexCollection> hVertices(&vertices, edm::ProductID(1, 1));
+    reco::VertexRefProd pvRefProd(hVertices);
+
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<float> uEta(-2.5, 2.5), uPhi(-M_PI, M_PI), uNear(0, 0.25), u01(0, 1);
+    std::exponential_distribution<float> uPt(0.3);
+    std::uniform_int_distribution<unsigned int> uLeptons(1, 3), uCands(0, 300), uType(0, 5);
+    const int pdgIds[6] = { 211, -211, 130, 22, 11, 13 };
+
+    unsigned int nBad = 0, nSelf = 0;
+    for (unsigned int event = 0; event < 1000; ++event) {
+        pat::PackedCandidateCollection cands;
+        auto addCandidate = [&](float pt, float eta, float phi, int pdgId, bool fromPV) {
+            pat::PackedCandidate::PolarLorentzVector p4(pt, eta, phi, 0);
+            cands.emplace_back(p4, pat::PackedCandidate::Point(0, 0, fromPV ? 0 : 3), pt, eta, phi, pdgId, pvRefProd, fromPV ? 0 : 1);
+        };
+        // the leptons are along a charged hadron from the PV, a neutral hadron or a photon
+        std::vector<unsigned int> leptons;
+        for (unsigned int l = 0, nl = uLeptons(rng); l < nl; ++l) {
+            const int selfIds[3] = { 211, 130, 22 };
+            leptons.push_back(cands.size());
+            addCandidate(5 + 95*u01(rng), uEta(rng), uPhi(rng), selfIds[l % 3], true);
+        }
+        for (unsigned int j = 0, n = uCands(rng); j < n; ++j) {
+            float eta = uEta(rng), phi = uPhi(rng);
+            if (u01(rng) < 0.5) {
+                // around a lepton
+                const pat::PackedCandidate & lep = cands[leptons[std::min<unsigned int>(leptons.size()-1, u01(rng)*leptons.size())]];
+                float dr = uNear(rng)*uNear(rng)*4, angle = 2*M_PI*u01(rng);
+                eta = lep.eta() + dr*std::cos(angle);
+                phi = reco::reduceRange(lep.phi() + dr*std::sin(angle));
+            }
+            addCandidate(0.1 + uPt(rng), eta, phi, pdgIds[uType(rng)], u01(rng) < 0.7);
+            bool near = false;
+            for (unsigned int l : leptons) {
+                float dr = reco::deltaR(cands[l].p4(), cands.back().p4());
+                for (const auto & p : params) near = near || nearBoundary(dr, cands[l].pt(), p);
+            }
+            if (near) cands.pop_back();
+        }
+
+        // as in PFIsolationProducer
+        pfIsolation::Candidates isoCands;
+        for (const pat::PackedCandidate & pf : cands) {
+            int cat = pfIsolation::category(pf.pdgId(), pf.fromPV());
+            if (cat < 0) continue;
+            isoCands.eta.push_back(pf.eta()); isoCands.phi.push_back(pf.phi()); isoCands.pt.push_back(pf.pt()); isoCands.category.push_back(cat);
+        }
+        matching::EtaPhiGrid grid(isoCands.eta.data(), isoCands.phi.data(), isoCands.eta.size(), 0.2);
+
+        for (unsigned int l = 0; l < leptons.size(); ++l) {
+            const pat::PackedCandidate & lep = cands[leptons[l]];
+            std::vector<float> sums(niso*pfIsolation::NCategories, 0.f);
+            pfIsolation::addSums(isolations, isoCands, grid, lep.eta(), lep.phi(), lep.pt(), std::vector<uint64_t>(), sums.data());
+            for (unsigned int k = 0; k < niso; ++k) {
+                const MiniIsoParams & p = params[k];
+                pat::PFIsolation ref = pat::getMiniPFIsolation(&cands, lep.p4(), p.mindr, p.maxdr, p.ktScale, p.ptThreshold,
+                                                               p.vetoCh, p.vetoPU, p.vetoPh, p.vetoNh, 0.0);
+                const float * s = &sums[k*pfIsolation::NCategories];
+                nBad += check("charged", s[pfIsolation::Charged], ref.chargedHadronIso(), event, l, p.name);
+                nBad += check("neutral", s[pfIsolation::Neutral], ref.neutralHadronIso(), event, l, p.name);
+                nBad += check("photon", s[pfIsolation::Photon], ref.photonIso(), event, l, p.name);
+                nBad += check("pileup", s[pfIsolation::PileUp], ref.puChargedHadronIso(), event, l, p.name);
+            }
+            ++nSelf;
+        }
+    }
+    std::printf("mini PF isolation: %u leptons with a candidate at deltaR = 0, %u mismatches\n", nSelf, nBad);
+    return nBad == 0 ? 0 : 1;
+}
@@ -0,0 +1,110 @@
+// Compares the outputs of the models of BaseMVAValueMapProducer evaluated together (mvaModels::evaluate on the variables
+// shared by all the models, as with the models parameter) with each model evaluated alone on its own variables, for the
+// BDTs of PhysicsTools/NanoAOD/data: the electron and muon TTH MVAs share all their variables but one, the b-jet
+// regression shares none. The values of the variables are random, between the cuts of the trees on them.
+// Returns a non-zero exit code if any output differs.
+
+#include "PhysicsTools/NanoAOD/interface/MVAModels.h"
+#include "FWCore/ParameterSet/interface/FileInPath.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <regex>
+#include <string>
+#include <vector>
+
+namespace {
+    struct Config {
+        const char * name;
+        const char * weightFile; // of the main model
+        std::vector<std::pair<std::string,std::string>> models; // (name, weight file) of the additional ones
+    };
+
+    BDTForestRegistry::ForestPtr forest(const std::string & file) {
+        return BDTForestRegistry::get(edm::FileInPath(file).fullPath());
+    }
+
+    /// adds the cut values of the trees of a weight file to cuts, per variable name
+    void addCuts(const std::string & file, std::map<std::string,std::vector<float>> & cuts) {
+        const std::vector<std::string> & variables = forest(file)->variables();
+        std::ifstream in(edm::FileInPath(file).fullPath());
+        std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        static const std::regex re("<Node [^>]*IVar=\"(-?[0-9]+)\"[^>]*Cut=\"([^\"]+)\"[^>]*nType=\"0\"");
+        for (std::sregex_iterator it(text.begin(), text.end(), re), end; it != end; ++it) {
+            int var = std::stoi((*it)[1]);
+            if (var >= 0 && var < int(variables.size())) cuts[variables[var]].push_back(std::stof((*it)[2]));
+        }
+    }
+
+    /// returns the number of mismatches
+    unsigned int compare(const Config & config, unsigned int n) {
+        // as in BaseMVAValueMapProducer: the main model, then the additional ones
+        std::vector<mvaModels::Model> models(1);
+        models.front().forest = forest(config.weightFile);
+        for (const auto & m : config.models) {
+            models.emplace_back();
+            models.back().name = m.first;
+            models.back().forest = forest(m.second);
+        }
+        std::map<std::string,size_t> positions;
+        for (mvaModels::Model & model : models) model.inputs = mvaModels::addInputs(positions, model.forest->variables());
+        const unsigned int nv = positions.size();
+
+        std::map<std::string,std::vector<float>> cuts;
+        addCuts(config.weightFile, cuts);
+        for (const auto & m : config.models) addCuts(m.second, cuts);
+        std::mt19937 rng(12345);
+        std::uniform_real_distribution<float> frac(0, 1);
+        std::map<std::string,std::vector<float>> values; // of each variable, for the n objects
+        for (const auto & p : positions) {
+            const std::vector<float> & c = cuts[p.first];
+            std::uniform_int_distribution<unsigned int> pick(0, c.empty() ? 0 : c.size()-1);
+            for (unsigned int i = 0; i < n; ++i) {
+                if (c.empty()) { values[p.first].push_back(0); continue; }
+                float a = c[pick(rng)], b = c[pick(rng)];
+                values[p.first].push_back(a + frac(rng)*(b-a));
+            }
+        }
+
+        std::vector<float> shared(n*nv);
+        for (const auto & p : positions) {
+            for (unsigned int i = 0; i < n; ++i) shared[i*nv+p.second] = values[p.first][i];
+        }
+        unsigned int nBad = 0;
+        std::vector<float> buffer, out(n), ref(n), alone;
+        for (const mvaModels::Model & model : models) {
+            mvaModels::evaluate(model, shared.data(), n, nv, buffer, out.data());
+            const std::vector<std::string> & variables = model.forest->variables();
+            const unsigned int ni = variables.size();
+            alone.resize(n*ni);
+            for (unsigned int i = 0; i < n; ++i) {
+                for (unsigned int k = 0; k < ni; ++k) alone[i*ni+k] = values[variables[k]][i];
+            }
+            model.forest->evaluate(alone.data(), n, ref.data());
+            unsigned int nModelBad = 0;
+            for (unsigned int i = 0; i < n; ++i) {
+                if (out[i] == ref[i]) continue;
+                if (nModelBad++ < 5) std::printf("%s, model '%s': object %u: %g instead of %g\n", config.name, model.name.c_str(), i, out[i], ref[i]);
+            }
+            std::printf("%s, model '%s': %u inputs among %u variables, %u mismatches\n", config.name, model.name.c_str(), ni, nv, nModelBad);
+            nBad += nModelBad;
+        }
+        return nBad;
+    }
+}
+
+int main() {
+    const Config configs[] = {
+        { "electron alone", "PhysicsTools/NanoAOD/data/el_BDTG.weights.xml", {} },
+        { "electron+muon+bjet", "PhysicsTools/NanoAOD/data/el_BDTG.weights.xml",
+          { { "mu", "PhysicsTools/NanoAOD/data/mu_BDTG.weights.xml" }, { "bjet", "PhysicsTools/NanoAOD/data/bjet-regression.xml" } } },
+        { "muon+electron", "PhysicsTools/NanoAOD/data/mu_BDTG.weights.xml",
+          { { "el", "PhysicsTools/NanoAOD/data/el_BDTG.weights.xml" } } },
+    };
+    unsigned int nBad = 0;
+    for (const Config & config : configs) nBad += compare(config, 10000);
+    return nBad == 0 ? 0 : 1;
+}
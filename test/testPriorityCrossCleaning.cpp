@@ -0,0 +1,164 @@
+// Compares the masks of NanoAODPriorityCrossCleaner (crossCleaning::computeMask) with references on random events:
+//  - priority Muon > Electron > Jet with shared constituents, against the rule of NanoAODSimpleCrossCleaner (each lepton is
+//    linked to the first jet sharing a source candidate with it, as in PATObjectCrossLinker, and the jets of the preselected
+//    leptons are removed). The leptons take their source candidates from a single jet, as the two rules differ otherwise
+//    (a lepton sharing candidates with two jets removes only the first one in the simple cleaner);
+//  - priority Electron > Muon > Tau with deltaR and shared constituents, against a brute-force loop over all the pairs.
+// Returns a non-zero exit code if any mask differs.
+
+#include "PhysicsTools/NanoAOD/interface/PriorityCrossCleaning.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+    enum Collection { Jet = 0, Muon, Electron, Tau, NCollections };
+    const char * collectionNames[NCollections] = { "Jet", "Muon", "Electron", "Tau" };
+
+    bool sharesKey(const std::vector<uint64_t> & k1, const std::vector<uint64_t> & k2) {
+        for (uint64_t k : k1) {
+            if (std::find(k2.begin(), k2.end(), k) != k2.end()) return true;
+        }
+        return false;
+    }
+
+    float wrapPhi(float phi) {
+        if (phi > float(M_PI)) phi -= float(2*M_PI);
+        if (phi < -float(M_PI)) phi += float(2*M_PI);
+        return phi;
+    }
+
+    float pairDeltaR2(const crossCleaning::Objects & a, unsigned int i, const crossCleaning::Objects & b, unsigned int j) {
+        return a.kin.deltaR2(i, b.kin.eta()[j], b.kin.phi()[j]);
+    }
+
+    crossCleaning::Mask makeMask(const std::vector<unsigned int> & priority) {
+        crossCleaning::Mask mask;
+        mask.priority = priority;
+        mask.criteria.resize(NCollections);
+        return mask;
+    }
+    void addCriterion(crossCleaning::Mask & mask, unsigned int removed, unsigned int other, float deltaR, bool sharedConstituents) {
+        crossCleaning::Criterion crit;
+        crit.other = other;
+        crit.deltaR2 = deltaR > 0 ? deltaR*deltaR : -1;
+        crit.sharedConstituents = sharedConstituents;
+        mask.criteria[removed].push_back(crit);
+    }
+
+    // ---- references ----
+
+    /// NanoAODSimpleCrossCleaner: jetBits[jetIdx] = 0 for the preselected leptons, with jetIdx from PATObjectCrossLinker
+    std::vector<std::vector<uint8_t>> simpleReference(const std::vector<crossCleaning::Objects> & objs) {
+        std::vector<std::vector<uint8_t>> kept(NCollections);
+        for (unsigned int c = 0; c < NCollections; ++c) kept[c] = objs[c].presel;
+        for (unsigned int c : { Muon, Electron }) {
+            for (unsigned int l = 0, nl = objs[c].presel.size(); l < nl; ++l) {
+                int jetIdx = -1;
+                for (unsigned int j = 0, nj = objs[Jet].presel.size(); j < nj && jetIdx == -1; ++j) {
+                    if (sharesKey(objs[c].keys[l], objs[Jet].keys[j])) jetIdx = j;
+                }
+                if (objs[c].presel[l] && jetIdx >= 0) kept[Jet][jetIdx] = 0;
+            }
+        }
+        return kept;
+    }
+
+    /// all the pairs, with the kept objects of the collections with higher priority
+    std::vector<std::vector<uint8_t>> bruteForceReference(const std::vector<crossCleaning::Objects> & objs, const crossCleaning::Mask & mask) {
+        std::vector<std::vector<uint8_t>> kept(NCollections);
+        for (unsigned int c = 0; c < NCollections; ++c) kept[c] = objs[c].presel;
+        for (unsigned int c : mask.priority) {
+            for (unsigned int i = 0, n = kept[c].size(); i < n; ++i) {
+                for (const crossCleaning::Criterion & crit : mask.criteria[c]) {
+                    for (unsigned int j = 0, no = kept[crit.other].size(); j < no; ++j) {
+                        if (!kept[crit.other][j]) continue;
+                        if ((crit.deltaR2 > 0 && pairDeltaR2(objs[c], i, objs[crit.other], j) < crit.deltaR2) ||
+                            (crit.sharedConstituents && sharesKey(objs[c].keys[i], objs[crit.other].keys[j]))) kept[c][i] = 0;
+                    }
+                }
+            }
+        }
+        return kept;
+    }
+
+    unsigned int check(const char * what, const std::vector<std::vector<uint8_t>> & test, const std::vector<std::vector<uint8_t>> & ref, unsigned int event) {
+        unsigned int nBad = 0;
+        for (unsigned int c = 0; c < NCollections; ++c) {
+            for (unsigned int i = 0, n = ref[c].size(); i < n; ++i) {
+                if (test[c][i] == ref[c][i]) continue;
+                if (nBad++ < 5) std::printf("%s: event %u, %s %u: mask %d instead of %d\n", what, event, collectionNames[c], i, test[c][i], ref[c][i]);
+            }
+        }
+        return nBad;
+    }
+}
+
+int main() {
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<float> uEta(-2.5, 2.5), uPhi(-M_PI, M_PI), uNear(-0.2, 0.2), u01(0, 1);
+    std::uniform_int_distribution<unsigned int> uN(0, 12), uConstituents(2, 10);
+
+    // priority Muon > Electron > Jet, as NanoAODSimpleCrossCleaner
+    crossCleaning::Mask simple = makeMask({ Muon, Electron, Jet });
+    addCriterion(simple, Jet, Muon, -1, true);
+    addCriterion(simple, Jet, Electron, -1, true);
+    // priority Electron > Muon > Tau, with deltaR
+    crossCleaning::Mask byDeltaR = makeMask({ Electron, Muon, Tau });
+    addCriterion(byDeltaR, Muon, Electron, 0.3, false);
+    addCriterion(byDeltaR, Tau, Muon, 0.4, false);
+    addCriterion(byDeltaR, Tau, Electron, 0.4, true);
+    std::vector<float> maxDeltaR(NCollections, 0); // of the criteria using each collection as other
+    maxDeltaR[Electron] = 0.4; maxDeltaR[Muon] = 0.4;
+
+    unsigned int nBad = 0, nRemoved = 0;
+    for (unsigned int event = 0; event < 5000; ++event) {
+        std::vector<crossCleaning::Objects> objs(NCollections);
+        uint64_t nextKey = 0;
+        for (unsigned int j = 0, nj = uN(rng); j < nj; ++j) {
+            objs[Jet].kin.push_back(30, uEta(rng), uPhi(rng), 0, 0);
+            objs[Jet].keys.emplace_back();
+            for (unsigned int k = 0, nk = uConstituents(rng); k < nk; ++k) objs[Jet].keys.back().push_back(nextKey++);
+        }
+        for (unsigned int c : { Muon, Electron, Tau }) {
+            for (unsigned int i = 0, n = uN(rng)/2; i < n; ++i) {
+                const unsigned int nj = objs[Jet].kin.size();
+                std::vector<uint64_t> keys;
+                if (nj && u01(rng) < 0.7) {
+                    // in a jet, taking one or two of its constituents
+                    unsigned int j = std::min<unsigned int>(nj-1, u01(rng)*nj);
+                    const auto & jetKeys = objs[Jet].keys[j];
+                    keys.push_back(jetKeys[std::min<unsigned int>(jetKeys.size()-1, u01(rng)*jetKeys.size())]);
+                    if (u01(rng) < 0.3) keys.push_back(jetKeys[std::min<unsigned int>(jetKeys.size()-1, u01(rng)*jetKeys.size())]);
+                    objs[c].kin.push_back(20, objs[Jet].kin.eta()[j] + uNear(rng), wrapPhi(objs[Jet].kin.phi()[j] + uNear(rng)), 0, 0);
+                } else {
+                    keys.push_back(nextKey++);
+                    objs[c].kin.push_back(20, uEta(rng), uPhi(rng), 0, 0);
+                }
+                objs[c].keys.push_back(keys);
+            }
+        }
+        for (unsigned int c = 0; c < NCollections; ++c) {
+            for (unsigned int i = 0, n = objs[c].kin.size(); i < n; ++i) objs[c].presel.push_back(u01(rng) < 0.8);
+        }
+        std::vector<std::unique_ptr<matching::EtaPhiGrid>> grids(NCollections);
+        for (unsigned int c = 0; c < NCollections; ++c) {
+            if (maxDeltaR[c] > 0) grids[c].reset(new matching::EtaPhiGrid(objs[c].kin.eta().data(), objs[c].kin.phi().data(), objs[c].kin.size(), maxDeltaR[c]));
+        }
+
+        std::vector<std::vector<uint8_t>> kept;
+        crossCleaning::computeMask(simple, objs, grids, kept);
+        for (unsigned int i = 0, n = kept[Jet].size(); i < n; ++i) nRemoved += objs[Jet].presel[i] && !kept[Jet][i];
+        nBad += check("simple", kept, simpleReference(objs), event);
+        crossCleaning::computeMask(byDeltaR, objs, grids, kept);
+        for (unsigned int c : { Muon, Tau }) {
+            for (unsigned int i = 0, n = kept[c].size(); i < n; ++i) nRemoved += objs[c].presel[i] && !kept[c][i];
+        }
+        nBad += check("deltaR", kept, bruteForceReference(objs, byDeltaR), event);
+    }
+    std::printf("priority cross cleaning: %u objects removed, %u mismatches\n", nRemoved, nBad);
+    return nBad == 0 ? 0 : 1;
+}